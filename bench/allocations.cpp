@@ -0,0 +1,38 @@
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions so benchmarks can report allocations per token or node.
+// The array and nothrow forms forward to these, aligned allocations are not counted.
+
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+std::atomic<std::size_t> allocated_bytes{0};
+
+}  // namespace
+
+auto lox::bench::allocation_counts() -> AllocationCounts {
+	return {.count = allocation_count.load(std::memory_order_relaxed),
+	        .bytes = allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+auto operator new(std::size_t size) -> void* {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+		return memory;
+	}
+	throw std::bad_alloc{};
+}
+
+auto operator delete(void* memory) noexcept -> void {
+	std::free(memory);
+}
+
+auto operator delete(void* memory, std::size_t /*size*/) noexcept -> void {
+	std::free(memory);
+}
@@ -0,0 +1,98 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lox::bench {
+
+enum class Unit { items, bytes };
+
+// Work done by one call of a benchmark body
+struct Throughput {
+	// Tokens, nodes, operands... reported as ns/item and allocations per item
+	std::size_t items = 0;
+	// Input size, reported as MB/s
+	std::size_t bytes = 0;
+};
+
+// Heap allocations made through operator new since the program started, counted by allocations.cpp
+struct AllocationCounts {
+	std::size_t count = 0;
+	std::size_t bytes = 0;
+};
+
+[[nodiscard]] auto allocation_counts() -> AllocationCounts;
+
+// Timing distribution and allocations of one benchmark case
+struct Result {
+	std::string name;
+	Throughput work;
+	std::size_t iterations = 0;
+	// Per call, in nanoseconds
+	double min    = 0;
+	double median = 0;
+	double mean   = 0;
+	double p90    = 0;
+	double p99    = 0;
+	double max    = 0;
+	// Per call, measured on the warm up call
+	std::size_t allocations     = 0;
+	std::size_t allocated_bytes = 0;
+};
+
+// Measures a body repeatedly until enough time has been spent, prints one line per case and keeps the results
+class Runner {
+private:
+	std::string_view filter_;
+	std::chrono::nanoseconds min_time_;
+	std::vector<Result> results_;
+
+public:
+	Runner(std::string_view filter, std::chrono::nanoseconds min_time) : filter_(filter), min_time_(min_time) {}
+
+	// Lets benchmarks skip expensive setup when none of their cases would run
+	[[nodiscard]] auto wants(std::string_view prefix) const -> bool {
+		return prefix.find(filter_) != std::string_view::npos || filter_.find(prefix) != std::string_view::npos;
+	}
+
+	auto measure(const std::string& name, Throughput work, const std::function<void()>& body) -> void;
+
+	// items is the amount of work done by one call of body (tokens, operands, ...),
+	// with Unit::bytes it is the input size and throughput is reported in MB/s
+	auto measure(const std::string& name, std::size_t items, const std::function<void()>& body,
+	             Unit unit = Unit::items) -> void {
+		measure(name, unit == Unit::bytes ? Throughput{.bytes = items} : Throughput{.items = items}, body);
+	}
+
+	[[nodiscard]] auto results() const -> const std::vector<Result>& { return results_; }
+};
+
+// Machine readable report of every result, for tracking across releases
+auto write_json(std::ostream& out, const std::vector<Result>& results) -> void;
+
+// Keeps the optimizer from discarding a computed result
+template <typename T>
+auto do_not_optimize(const T& value) -> void {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+using BenchFn = void (*)(Runner&);
+
+auto registry() -> std::vector<std::pair<std::string_view, BenchFn>>&;
+
+struct Registration {
+	Registration(std::string_view name, BenchFn fn) { registry().emplace_back(name, fn); }
+};
+
+}  // namespace lox::bench
+
+#define LOX_BENCHMARK(fn) static const ::lox::bench::Registration fn##_registration{#fn, fn}
+
+#endif
@@ -0,0 +1,71 @@
+#include "bench.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <lox/arena.hpp>
+#include <lox/chunk_cache.hpp>
+#include <lox/compiler.hpp>
+#include <lox/parser.hpp>
+#include <lox/source_file.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+// Getting from an unchanged script file to a runnable chunk, with and without the cache
+auto startup(lox::bench::Runner& runner) -> void {
+	if (!runner.wants("startup/")) {
+		return;
+	}
+	auto directory = std::filesystem::temp_directory_path() / ("lox_bench_cache_" + std::to_string(::getpid()));
+	std::filesystem::create_directories(directory);
+	auto path = directory / "script.lox";
+	{
+		// No number literals, every one would take a constant slot
+		std::string source = "var a = nil; var b = \"b\"; var c = true;\n";
+		while (source.size() < 1024 * 1024) {
+			source += "{ var x = b + \"some text\"; if (c and x != b) { print x; } else { a = x; } }\n";
+		}
+		std::ofstream(path, std::ios::binary) << source;
+	}
+	auto size = std::filesystem::file_size(path);
+	lox::ChunkCache cache{directory / "cache"};
+	{
+		auto file = lox::SourceFile::open(path);
+		(void)cache.compile(file.view());
+	}
+
+	runner.measure(
+	    "startup/compile", size,
+	    [&] {
+		    auto file = lox::SourceFile::open(path);
+		    lox::Arena arena;
+		    auto program = lox::parse_program(file.view(), arena);
+		    lox::bench::do_not_optimize(lox::Compiler{}.compile(*program).code.size());
+	    },
+	    lox::bench::Unit::bytes);
+
+	runner.measure(
+	    "startup/cache_hit", size,
+	    [&] {
+		    auto file = lox::SourceFile::open(path);
+		    lox::bench::do_not_optimize(cache.load(file.view())->code.size());
+	    },
+	    lox::bench::Unit::bytes);
+
+	// The stale check alone
+	runner.measure(
+	    "startup/content_hash", size,
+	    [&] {
+		    auto file = lox::SourceFile::open(path);
+		    lox::bench::do_not_optimize(lox::content_hash(file.view()));
+	    },
+	    lox::bench::Unit::bytes);
+
+	std::filesystem::remove_all(directory);
+}
+LOX_BENCHMARK(startup);
+
+}  // namespace
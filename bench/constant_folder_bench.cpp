@@ -0,0 +1,84 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <lox/arena.hpp>
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/constant_folder.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+// Shaped like generated configuration: settings spelled out as arithmetic on constants,
+// feature flags combined with and/or, a few values depending on earlier settings
+auto generated_config(std::size_t settings) -> std::string {
+	std::string source;
+	for (std::size_t i = 0; i < settings; i++) {
+		auto n = std::to_string(i);
+		source += "var timeout_" + n + " = (60 * 60) * (24 + " + n + ") / 1000;\n";
+		source += "var enabled_" + n + " = (" + n + " > 10 and true) or false;\n";
+		source += "var label_" + n + " = \"svc-\" + \"" + n + "\";\n";
+		source += "var scaled_" + n + " = timeout_" + n + " * (2 + 2);\n";
+	}
+	return source;
+}
+
+auto config_folding(lox::bench::Runner& runner) -> void {
+	constexpr std::size_t settings = 2'000;
+	auto source                    = generated_config(settings);
+	lox::Scanner scanner{source};
+	std::vector<lox::Token> tokens = scanner.scan_tokens();
+
+	// Reports the shrinkage once, timings alone don't show it
+	if (runner.wants("fold/config")) {
+		lox::Arena arena;
+		lox::Parser parser{tokens, arena};
+		auto program = parser.parse();
+		std::size_t nodes = 0;
+		for (const auto& stmt : program) {
+			nodes += lox::count_nodes(std::get<lox::Box<lox::Var>>(stmt)->initializer);
+		}
+		lox::ConstantFolder folder{arena};
+		folder.fold(program);
+		std::cout << "fold/config eliminated " << folder.eliminated() << " of " << nodes << " expression nodes\n";
+	}
+
+	runner.measure("fold/config/parse_and_fold", settings, [&] {
+		lox::Arena arena;
+		lox::Parser parser{tokens, arena};
+		auto program = parser.parse();
+		lox::ConstantFolder folder{arena};
+		folder.fold(program);
+		lox::bench::do_not_optimize(folder.eliminated());
+	});
+
+	auto compile = [&](bool folded) {
+		lox::Arena arena;
+		lox::Parser parser{tokens, arena};
+		auto program = parser.parse();
+		if (folded) {
+			lox::ConstantFolder{arena}.fold(program);
+		}
+		return lox::Compiler{}.compile(program);
+	};
+	auto raw    = compile(false);
+	auto folded = compile(true);
+	runner.measure("fold/config/run_raw", settings, [&] {
+		lox::VM vm;
+		vm.run(raw);
+	});
+	runner.measure("fold/config/run_folded", settings, [&] {
+		lox::VM vm;
+		vm.run(folded);
+	});
+}
+LOX_BENCHMARK(config_folding);
+
+}  // namespace
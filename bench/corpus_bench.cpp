@@ -0,0 +1,129 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <lox/arena.hpp>
+#include <lox/compiler.hpp>
+#include <lox/constant_folder.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+// One shape of synthetic input, built from a single operand repeated and joined with `op`
+struct Corpus {
+	const char* name;
+	std::string operand;
+	const char* op;
+};
+
+// Globals every operand reads, so the pipeline cases run without runtime errors
+const char* const prelude =
+    "var a = 1; var b = 2; var c = 3; var d = 4;\n"
+    "var a_long_descriptive_name_0 = 1; var another_descriptive_name_1 = 2;\n";
+
+// Number literals are left out on purpose: each one takes a constant slot and a chunk holds at most 65536
+auto corpora() -> std::vector<Corpus> {
+	return {
+	    {"nested", std::string(32, '(') + "a + b" + std::string(32, ')'), " * "},
+	    {"chain", "a + b - c * d / a", " + "},
+	    {"identifiers", "a_long_descriptive_name_0 + another_descriptive_name_1", " - "},
+	    {"strings", "\"a string literal long enough to span a few vectors\"", " + "},
+	    {"comments", "a // " + std::string(80, '=') + " a generated comment on every operand\n", " + "},
+	};
+}
+
+// A single expression of about `size` bytes, for parse_expression
+auto expression(const Corpus& corpus, std::size_t size) -> std::string {
+	std::string source = corpus.operand;
+	while (source.size() < size) {
+		source += corpus.op + corpus.operand;
+	}
+	return source + ";";
+}
+
+// Expression statements of 16 operands each, about `size` bytes after the prelude
+auto program(const std::vector<const Corpus*>& mix, std::size_t size) -> std::string {
+	std::string source = prelude;
+	for (std::size_t i = 0; source.size() < size; i++) {
+		const auto& corpus = *mix[i % mix.size()];
+		source += corpus.operand;
+		for (int operand = 1; operand < 16; operand++) {
+			source += corpus.op + corpus.operand;
+		}
+		source += ";\n";
+	}
+	return source;
+}
+
+auto scan(lox::bench::Runner& runner, const std::string& name, const std::string& source) -> void {
+	auto tokens = lox::Scanner{source}.scan_tokens().size();
+	runner.measure(name + "/scan", {.items = tokens, .bytes = source.size()}, [&] {
+		lox::Scanner scanner{source};
+		lox::bench::do_not_optimize(scanner.scan_tokens().size());
+	});
+}
+
+auto parse_expression(lox::bench::Runner& runner, const std::string& name, const std::string& source) -> void {
+	lox::Scanner scanner{source};
+	std::vector<lox::Token> tokens = scanner.scan_tokens();
+	std::size_t nodes;
+	{
+		lox::Arena arena;
+		lox::Parser parser{tokens, arena};
+		nodes = lox::count_nodes(parser.parse_expression().front());
+	}
+	runner.measure(name + "/parse_expression", {.items = nodes, .bytes = source.size()}, [&] {
+		lox::Arena arena;
+		lox::Parser parser{tokens, arena};
+		lox::bench::do_not_optimize(parser.parse_expression().data());
+	});
+}
+
+// Scan, parse, resolve, compile and run, items are tokens
+auto pipeline(lox::bench::Runner& runner, const std::string& name, const std::string& source) -> void {
+	auto tokens = lox::Scanner{source}.scan_tokens().size();
+	runner.measure(name + "/pipeline", {.items = tokens, .bytes = source.size()}, [&] {
+		lox::Arena arena;
+		auto program = lox::parse_program(source, arena);
+		auto chunk   = lox::Compiler{}.compile(*program);
+		std::ostringstream out;
+		lox::VM vm{out};
+		lox::bench::do_not_optimize(vm.run(chunk));
+	});
+}
+
+auto corpus_suite(lox::bench::Runner& runner) -> void {
+	constexpr std::size_t expression_size = 64 * 1024;
+	constexpr std::size_t program_size    = 1024 * 1024;
+	constexpr std::size_t multi_mb_size   = 8 * 1024 * 1024;
+
+	auto all = corpora();
+	for (const auto& corpus : all) {
+		auto name = std::string{"corpus/"} + corpus.name;
+		if (!runner.wants(name)) {
+			continue;
+		}
+		auto source = program({&corpus}, program_size);
+		scan(runner, name, source);
+		parse_expression(runner, name, expression(corpus, expression_size));
+		pipeline(runner, name, source);
+	}
+
+	if (runner.wants("corpus/multi_mb")) {
+		std::vector<const Corpus*> mix;
+		for (const auto& corpus : all) {
+			mix.push_back(&corpus);
+		}
+		auto source = program(mix, multi_mb_size);
+		scan(runner, "corpus/multi_mb", source);
+		pipeline(runner, "corpus/multi_mb", source);
+	}
+}
+LOX_BENCHMARK(corpus_suite);
+
+}  // namespace
@@ -0,0 +1,92 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/object.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+auto compile(const std::string& source) -> lox::Chunk {
+	lox::Scanner scanner{source};
+	std::vector<lox::Token> tokens = scanner.scan_tokens();
+	lox::Parser parser{tokens};
+	return lox::Compiler{}.compile(parser.parse());
+}
+
+// Every iteration allocates a longer string and drops the previous one
+auto concat_loop(lox::bench::Runner& runner) -> void {
+	constexpr int iterations = 5'000;
+	auto chunk = compile("var s = \"\"; for (var i = 0; i < " + std::to_string(iterations) + "; i = i + 1) s = s + \"x\";");
+
+	for (double growth : {1.5, 2.0, 4.0}) {
+		auto name = "gc/concat/growth_" + std::to_string(growth).substr(0, 3);
+		lox::GcConfig config{.initial_heap_size = 256 * 1024, .growth_factor = growth};
+		if (runner.wants(name)) {
+			lox::VM vm{std::cout, config};
+			vm.run(chunk);
+			const auto& stats = vm.gc_stats();
+			std::cout << name << " collections " << stats.collections << ", max pause " << stats.max_pause.count()
+			          << " ns, live " << stats.bytes_allocated << " bytes\n";
+		}
+		runner.measure(name, iterations, [&] {
+			lox::VM vm{std::cout, config};
+			vm.run(chunk);
+		});
+	}
+}
+LOX_BENCHMARK(concat_loop);
+
+auto percentile(std::vector<std::chrono::nanoseconds>& samples, double fraction) -> long long {
+	if (samples.empty()) {
+		return 0;
+	}
+	auto index = static_cast<std::size_t>(fraction * static_cast<double>(samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+	return samples[index].count();
+}
+
+// A large live set of globals with a steady stream of short lived strings,
+// stop the world pauses scale with the heap while incremental steps stay bounded by the budget
+auto pause_times(lox::bench::Runner& runner) -> void {
+	constexpr int live_strings = 20'000;
+	constexpr int iterations   = 20'000;
+	std::string source;
+	for (int i = 0; i < live_strings; i++) {
+		auto n = std::to_string(i);
+		source += "var g" + n + " = \"live\" + \"" + n + "\";\n";
+	}
+	source += "var s = \"\"; for (var i = 0; i < " + std::to_string(iterations) +
+	          "; i = i + 1) { s = s + \"x\"; if (s == \"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\") s = \"\"; var t = s + \"y\"; }";
+	auto chunk = compile(source);
+
+	for (auto mode : {lox::GcMode::stop_the_world, lox::GcMode::incremental}) {
+		auto name = std::string{"gc/pauses/"} + (mode == lox::GcMode::incremental ? "incremental" : "stop_the_world");
+		std::vector<std::chrono::nanoseconds> pauses;
+		lox::GcConfig config{.mode              = mode,
+		                     .initial_heap_size = 512 * 1024,
+		                     .on_pause          = [&](std::chrono::nanoseconds pause) { pauses.push_back(pause); }};
+		if (runner.wants(name)) {
+			lox::VM vm{std::cout, config};
+			vm.run(chunk);
+			std::cout << name << " pauses " << pauses.size() << ", p50 " << percentile(pauses, 0.5) << " ns, p99 "
+			          << percentile(pauses, 0.99) << " ns, max " << vm.gc_stats().max_pause.count() << " ns\n";
+		}
+		runner.measure(name, iterations, [&] {
+			lox::VM vm{std::cout, config};
+			vm.run(chunk);
+		});
+	}
+}
+LOX_BENCHMARK(pause_times);
+
+}  // namespace
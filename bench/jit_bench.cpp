@@ -0,0 +1,50 @@
+#include "bench.hpp"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <lox/arena.hpp>
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/jit.hpp>
+#include <lox/parser.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+auto compile(const std::string& source) -> lox::Chunk {
+	lox::Arena arena;
+	return lox::Compiler{{.enabled = true}}.compile(*lox::parse_program(source, arena));
+}
+
+// Numeric loops whose bodies are one large expression, interpreted and with the expression compiled
+auto arithmetic(lox::bench::Runner& runner) -> void {
+	constexpr int iterations = 100'000;
+	auto loop                = [&](std::string_view body) {
+		return compile("{ var sum = 0; for (var x = 0; x < " + std::to_string(iterations) + "; x = x + 1) { " +
+		               std::string{body} + " } }");
+	};
+	struct Case {
+		const char* name;
+		lox::Chunk chunk;
+	};
+	Case cases[] = {
+	    {"polynomial", loop("sum = sum + (x * x - 3 * x + 2) / (x + 1);")},
+	    {"horner", loop("sum = ((((sum * 0.5 + x) * 0.5 + x) * 0.5 + x) * 0.5 + x) * 0.5;")},
+	    {"compare", loop("if (x > 10 and x < 90000 or x == 5 and sum >= 0) sum = sum + 1;")},
+	};
+	for (const auto& c : cases) {
+		runner.measure(std::string{"jit/"} + c.name + "/interpreter", iterations, [&] {
+			lox::VM vm{std::cout, {}, {.enabled = false}};
+			vm.run(c.chunk);
+		});
+		runner.measure(std::string{"jit/"} + c.name + "/native", iterations, [&] {
+			lox::VM vm{std::cout, {}, {.enabled = true}};
+			vm.run(c.chunk);
+		});
+	}
+}
+LOX_BENCHMARK(arithmetic);
+
+}  // namespace
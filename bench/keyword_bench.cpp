@@ -0,0 +1,63 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lox/scanner.hpp>
+#include <lox/tokens.hpp>
+
+namespace {
+
+// Mix of keywords, keyword prefixes and plain identifiers as found in scripts
+auto words() -> std::vector<std::string> {
+	std::vector<std::string> base = {"var",   "counter", "for",  "i",     "while", "print", "if",    "else",
+	                                 "value", "nil",     "true", "false", "fun",   "func",  "and",   "orbit",
+	                                 "class", "classy",  "this", "super", "x",     "retur", "return"};
+	std::vector<std::string> result;
+	for (int i = 0; i < 200; i++) {
+		result.insert(result.end(), base.begin(), base.end());
+	}
+	return result;
+}
+
+auto keyword_lookup(lox::bench::Runner& runner) -> void {
+	static const auto corpus = words();
+
+	// The lookup the scanner used before keyword_type
+	std::map<std::string_view, lox::TokenType> map;
+	for (const auto& keyword : lox::keywords) {
+		map.emplace(keyword.text, keyword.type);
+	}
+
+	runner.measure("keywords/std_map", corpus.size(), [&] {
+		std::size_t found = 0;
+		for (const auto& word : corpus) {
+			auto it = map.find(word);
+			found += it != map.end() ? static_cast<std::size_t>(it->second) : 0;
+		}
+		lox::bench::do_not_optimize(found);
+	});
+
+	runner.measure("keywords/perfect_hash", corpus.size(), [&] {
+		std::size_t found = 0;
+		for (const auto& word : corpus) {
+			found += static_cast<std::size_t>(lox::keyword_type(word));
+		}
+		lox::bench::do_not_optimize(found);
+	});
+
+	std::string source;
+	for (const auto& word : corpus) {
+		source += word + " ";
+	}
+	runner.measure("keywords/scan_source", corpus.size(), [&] {
+		lox::Scanner scanner{source};
+		lox::bench::do_not_optimize(scanner.scan_tokens().size());
+	});
+}
+LOX_BENCHMARK(keyword_lookup);
+
+}  // namespace
@@ -0,0 +1,170 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef LOX_BENCH_BUILD_TYPE
+#define LOX_BENCH_BUILD_TYPE "unknown"
+#endif
+#ifndef LOX_BENCH_DISPATCH
+#define LOX_BENCH_DISPATCH "unknown"
+#endif
+
+namespace lox::bench {
+
+namespace {
+
+// Nearest rank percentile of sorted samples
+auto percentile(const std::vector<std::chrono::nanoseconds>& sorted, double p) -> double {
+	auto rank = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+	return static_cast<double>(sorted[std::min(rank, sorted.size() - 1)].count());
+}
+
+auto per_item(std::size_t count, const Throughput& work) -> double {
+	return static_cast<double>(count) / static_cast<double>(std::max<std::size_t>(work.items, 1));
+}
+
+auto write_string(std::ostream& out, std::string_view text) -> void {
+	out << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out << '\\';
+		}
+		out << c;
+	}
+	out << '"';
+}
+
+}  // namespace
+
+auto registry() -> std::vector<std::pair<std::string_view, BenchFn>>& {
+	static std::vector<std::pair<std::string_view, BenchFn>> benchmarks;
+	return benchmarks;
+}
+
+auto Runner::measure(const std::string& name, Throughput work, const std::function<void()>& body) -> void {
+	if (name.find(filter_) == std::string::npos) {
+		return;
+	}
+	using clock = std::chrono::steady_clock;
+
+	// Warm up caches and the allocator before timing, counting the allocations of one call on the way
+	auto before = allocation_counts();
+	body();
+	auto after = allocation_counts();
+
+	std::vector<std::chrono::nanoseconds> samples;
+	auto total = std::chrono::nanoseconds{0};
+	while (total < min_time_ || samples.size() < 3) {
+		auto start = clock::now();
+		body();
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+		samples.push_back(elapsed);
+		total += elapsed;
+	}
+	std::ranges::sort(samples);
+
+	Result result{
+	    .name            = name,
+	    .work            = work,
+	    .iterations      = samples.size(),
+	    .min             = static_cast<double>(samples.front().count()),
+	    .median          = percentile(samples, 0.5),
+	    .mean            = static_cast<double>(total.count()) / static_cast<double>(samples.size()),
+	    .p90             = percentile(samples, 0.9),
+	    .p99             = percentile(samples, 0.99),
+	    .max             = static_cast<double>(samples.back().count()),
+	    .allocations     = after.count - before.count,
+	    .allocated_bytes = after.bytes - before.bytes,
+	};
+
+	std::printf("%-40s %10zu iters %14.0f ns/op %14.0f p99", name.c_str(), result.iterations, result.median,
+	            result.p99);
+	if (work.bytes != 0) {
+		// bytes per nanosecond * 1000 = MB/s
+		std::printf(" %10.1f MB/s", static_cast<double>(work.bytes) * 1000.0 / result.median);
+	}
+	if (work.items != 0) {
+		std::printf(" %10.2f ns/item %8.3f allocs/item", result.median / static_cast<double>(work.items),
+		            per_item(result.allocations, work));
+	}
+	std::printf("\n");
+	results_.push_back(std::move(result));
+}
+
+auto write_json(std::ostream& out, const std::vector<Result>& results) -> void {
+	auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	char timestamp[32];
+	std::strftime(timestamp, sizeof timestamp, "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+	out << std::setprecision(12) << "{\n  \"context\": {\"date\": \"" << timestamp << "\", \"compiler\": ";
+	write_string(out, __VERSION__);
+	out << ", \"build_type\": ";
+	write_string(out, LOX_BENCH_BUILD_TYPE);
+	out << ", \"dispatch\": ";
+	write_string(out, LOX_BENCH_DISPATCH);
+	out << "},\n  \"benchmarks\": [";
+
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const auto& result = results[i];
+		out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+		write_string(out, result.name);
+		out << ", \"iterations\": " << result.iterations << ", \"items\": " << result.work.items
+		    << ", \"bytes\": " << result.work.bytes << ",\n     \"ns\": {\"min\": " << result.min
+		    << ", \"p50\": " << result.median << ", \"p90\": " << result.p90 << ", \"p99\": " << result.p99
+		    << ", \"max\": " << result.max << ", \"mean\": " << result.mean << "},\n     \"ns_per_item\": "
+		    << (result.work.items == 0 ? 0.0 : result.median / static_cast<double>(result.work.items))
+		    << ", \"mb_per_s\": "
+		    << (result.work.bytes == 0 ? 0.0 : static_cast<double>(result.work.bytes) * 1000.0 / result.median)
+		    << ",\n     \"allocations\": " << result.allocations << ", \"allocated_bytes\": " << result.allocated_bytes
+		    << ", \"allocations_per_item\": " << per_item(result.allocations, result.work)
+		    << ", \"allocated_bytes_per_item\": " << per_item(result.allocated_bytes, result.work) << "}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+}  // namespace lox::bench
+
+// lox_bench [filter] [--json=FILE] [--min-time=MS]
+auto main(int argc, char** argv) -> int {
+	std::string_view filter;
+	std::string_view json_path;
+	auto min_time = std::chrono::milliseconds{200};
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		if (arg.starts_with("--json=")) {
+			json_path = arg.substr(7);
+		} else if (arg.starts_with("--min-time=")) {
+			min_time = std::chrono::milliseconds{std::stol(std::string{arg.substr(11)})};
+		} else if (arg.starts_with("--")) {
+			std::cerr << "Usage: lox_bench [filter] [--json=FILE] [--min-time=MS]\n";
+			return 64;
+		} else {
+			filter = arg;
+		}
+	}
+
+	lox::bench::Runner runner{filter, min_time};
+	for (auto& [name, fn] : lox::bench::registry()) {
+		fn(runner);
+	}
+
+	if (!json_path.empty()) {
+		std::ofstream out{std::string{json_path}};
+		if (!out) {
+			std::cerr << "Could not write " << json_path << "\n";
+			return 74;
+		}
+		lox::bench::write_json(out, runner.results());
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include "bench.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lox/scanner.hpp>
+
+namespace {
+
+// Throughput of the chunked scanner as threads are added, 1 thread is the sequential scanner
+auto parallel_scaling(lox::bench::Runner& runner) -> void {
+	if (!runner.wants("scanner/parallel/")) {
+		return;
+	}
+	std::string source;
+	for (int i = 0; source.size() < 16 * 1024 * 1024; i++) {
+		source += "var v" + std::to_string(i) + " = (a + " + std::to_string(i) + ") * \"text\"; // generated\n";
+	}
+	// Every line indented and blank lines between functions, as most real scripts look
+	std::string indented;
+	for (int i = 0; indented.size() < 16 * 1024 * 1024; i++) {
+		indented += "fun f" + std::to_string(i) + "(a) {\n    if (a > 1) {\n        print a;\n    }\n    return a;\n}\n\n";
+	}
+	// Just above the size scanned in parallel, where handing out chunks costs the most relative to scanning
+	auto small = source.substr(0, 512 * 1024);
+
+	std::vector<unsigned int> thread_counts{1, 2, 4, 8};
+	auto cores = std::thread::hardware_concurrency();
+	if (cores > 8) {
+		thread_counts.push_back(cores);
+	}
+	for (auto threads : thread_counts) {
+		runner.measure(
+		    "scanner/parallel/" + std::to_string(threads), source.size(),
+		    [&] {
+			    lox::Scanner scanner{source};
+			    lox::bench::do_not_optimize(scanner.scan_tokens_parallel(threads).size());
+		    },
+		    lox::bench::Unit::bytes);
+		runner.measure(
+		    "scanner/parallel/indented/" + std::to_string(threads), indented.size(),
+		    [&] {
+			    lox::Scanner scanner{indented};
+			    lox::bench::do_not_optimize(scanner.scan_tokens_parallel(threads).size());
+		    },
+		    lox::bench::Unit::bytes);
+		runner.measure(
+		    "scanner/parallel/small/" + std::to_string(threads), small.size(),
+		    [&] {
+			    lox::Scanner scanner{small};
+			    lox::bench::do_not_optimize(scanner.scan_tokens_parallel(threads).size());
+		    },
+		    lox::bench::Unit::bytes);
+	}
+}
+LOX_BENCHMARK(parallel_scaling);
+
+}  // namespace
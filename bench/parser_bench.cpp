@@ -0,0 +1,90 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <lox/arena.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+
+namespace {
+
+// "a + b + c + ..." style chain, parsed left associative one Binary per operator
+auto operator_chain(std::size_t operands) -> std::string {
+	std::string source;
+	for (std::size_t i = 0; i < operands; i++) {
+		source += i == 0 ? "x" : " + x";
+	}
+	return source + ";";
+}
+
+auto long_chains(lox::bench::Runner& runner) -> void {
+	// Doubling the operand count should double ns/op, ns/item stays flat when parsing is linear
+	for (std::size_t operands : {1'000, 2'000, 5'000, 10'000, 20'000}) {
+		auto source = operator_chain(operands);
+		lox::Scanner scanner{source};
+		std::vector<lox::Token> tokens = scanner.scan_tokens();
+
+		runner.measure("parse/chain/" + std::to_string(operands), operands, [&] {
+			lox::Arena arena;
+			lox::Parser parser{tokens, arena};
+			parser.parse_expression();
+		});
+	}
+}
+LOX_BENCHMARK(long_chains);
+
+// Scanning everything up front versus parsing straight from the scanner
+auto token_streaming(lox::bench::Runner& runner) -> void {
+	std::string source;
+	for (int i = 0; source.size() < 2 * 1024 * 1024; i++) {
+		source += "var v" + std::to_string(i) + " = (a + " + std::to_string(i) + ") * b - c / 2 >= d or e;\n";
+	}
+
+	runner.measure(
+	    "parse/program/token_array", source.size(),
+	    [&] {
+		    lox::Scanner scanner{source};
+		    std::vector<lox::Token> tokens = scanner.scan_tokens();
+		    lox::Parser parser{tokens};
+		    lox::bench::do_not_optimize(parser.parse().size());
+	    },
+	    lox::bench::Unit::bytes);
+
+	runner.measure(
+	    "parse/program/streaming", source.size(),
+	    [&] {
+		    lox::Scanner scanner{source};
+		    lox::Parser parser{scanner};
+		    lox::bench::do_not_optimize(parser.parse().size());
+	    },
+	    lox::bench::Unit::bytes);
+}
+LOX_BENCHMARK(token_streaming);
+
+// Every statement carries a syntax error, recovery has to keep ns/item flat as the error count grows
+auto error_recovery(lox::bench::Runner& runner) -> void {
+	for (std::size_t statements : {1'000, 10'000, 100'000}) {
+		std::string source;
+		for (std::size_t i = 0; i < statements; i++) {
+			switch (i % 4) {
+				case 0: source += "var = " + std::to_string(i) + ";\n"; break;
+				case 1: source += "print (a + ;\n"; break;
+				case 2: source += "{ a = b print c }\n"; break;
+				default: source += "1 + 2 = 3;\n"; break;
+			}
+		}
+		lox::Scanner scanner{source};
+		std::vector<lox::Token> tokens = scanner.scan_tokens();
+
+		runner.measure("parse/errors/" + std::to_string(statements), statements, [&] {
+			lox::Parser parser{tokens};
+			parser.parse();
+			lox::bench::do_not_optimize(parser.diagnostics().error_count());
+		});
+	}
+}
+LOX_BENCHMARK(error_recovery);
+
+}  // namespace
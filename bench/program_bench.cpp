@@ -0,0 +1,69 @@
+#include "bench.hpp"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lox/program.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+// A short evaluation as a service would run thousands of: strings, an object and a small loop
+const std::string script = "class Order {} var order = Order(); order.total = 0; var label = \"order\" + \"#1\";\n"
+                           "for (var i = 0; i < 50; i = i + 1) { order.total = order.total + i * 1.5 - 2; }\n"
+                           "order.total > 100 and label != \"\";";
+
+// Independent runs of one shared Program as workers are added, each worker owns and resets its VM.
+// ns/item is wall time per run across all workers, it halves with each doubling while cores are free
+auto runtime_scaling(lox::bench::Runner& runner) -> void {
+	if (!runner.wants("runtime/")) {
+		return;
+	}
+	constexpr std::size_t runs = 200;
+	auto program               = *lox::compile_program(script);
+
+	runner.measure("runtime/new_vm", runs, [&] {
+		for (std::size_t i = 0; i < runs; i++) {
+			std::ostringstream out;
+			lox::VM vm{out};
+			lox::bench::do_not_optimize(vm.run(program));
+		}
+	});
+	runner.measure("runtime/reset_vm", runs, [&] {
+		std::ostringstream out;
+		lox::VM vm{out};
+		for (std::size_t i = 0; i < runs; i++) {
+			lox::bench::do_not_optimize(vm.run(program));
+			vm.reset();
+		}
+	});
+
+	std::vector<unsigned int> thread_counts{1, 2, 4, 8};
+	auto cores = std::thread::hardware_concurrency();
+	if (cores > 8) {
+		thread_counts.push_back(cores);
+	}
+	for (auto threads : thread_counts) {
+		runner.measure("runtime/threads/" + std::to_string(threads), runs * threads, [&] {
+			std::vector<std::thread> workers;
+			for (unsigned int t = 0; t < threads; t++) {
+				workers.emplace_back([&] {
+					std::ostringstream out;
+					lox::VM vm{out};
+					for (std::size_t i = 0; i < runs; i++) {
+						lox::bench::do_not_optimize(vm.run(program));
+						vm.reset();
+					}
+				});
+			}
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		});
+	}
+}
+LOX_BENCHMARK(runtime_scaling);
+
+}  // namespace
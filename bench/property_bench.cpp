@@ -0,0 +1,73 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+auto compile(const std::string& source) -> lox::Chunk {
+	lox::Scanner scanner{source};
+	std::vector<lox::Token> tokens = scanner.scan_tokens();
+	lox::Parser parser{tokens};
+	return lox::Compiler{}.compile(parser.parse());
+}
+
+// o.v sites fed instances of `shapes` layouts in turn: instance j gets j filler fields before v.
+// Every variant runs the same selection code, so the differences come from the inline cache
+auto shape_loop(int shapes, int iterations) -> std::string {
+	std::string source = "class C {}\n";
+	for (int j = 0; j < 8; j++) {
+		auto object = "o" + std::to_string(j);
+		source += "var " + object + " = C();";
+		for (int field = 0; field < j; field++) {
+			source += " " + object + ".f" + std::to_string(field) + " = 0;";
+		}
+		source += " " + object + ".v = 1;\n";
+	}
+	source += "{ var o = o0; var k = 0; var sum = 0;\nfor (var i = 0; i < " + std::to_string(iterations) +
+	          "; i = i + 1) {\n";
+	for (int j = 0; j < 8; j++) {
+		source += "  if (k == " + std::to_string(j) + ") o = o" + std::to_string(j) + ";\n";
+	}
+	source += "  k = k + 1; if (k == " + std::to_string(shapes) + ") k = 0;\n";
+	source += "  sum = sum + o.v + o.v + o.v + o.v + o.v + o.v + o.v + o.v;\n} }\n";
+	return source;
+}
+
+auto property_access(lox::bench::Runner& runner) -> void {
+	constexpr int iterations = 100'000;
+	struct Case {
+		const char* name;
+		int shapes;
+	};
+	for (auto [name, shapes] : {Case{"property/get/monomorphic", 1}, Case{"property/get/polymorphic", 4},
+	                            Case{"property/get/megamorphic", 8}}) {
+		if (!runner.wants(name)) {
+			continue;
+		}
+		auto chunk = compile(shape_loop(shapes, iterations));
+		{
+			lox::VM vm;
+			vm.run(chunk);
+			const auto& stats = vm.ic_stats();
+			std::printf("%s hit rate %.4f (%zu monomorphic, %zu polymorphic, %zu misses, %zu megamorphic)\n", name,
+			            stats.hit_rate(), stats.monomorphic_hits, stats.polymorphic_hits, stats.misses,
+			            stats.megamorphic_misses);
+		}
+		runner.measure(name, 8 * iterations, [&] {
+			lox::VM vm;
+			vm.run(chunk);
+		});
+	}
+}
+LOX_BENCHMARK(property_access);
+
+}  // namespace
@@ -0,0 +1,53 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <lox/scan_kernels.hpp>
+#include <lox/scanner.hpp>
+
+namespace {
+
+constexpr std::size_t corpus_size = 4 * 1024 * 1024;
+
+auto repeat(const std::string& snippet) -> std::string {
+	std::string source;
+	source.reserve(corpus_size + snippet.size());
+	while (source.size() < corpus_size) {
+		source += snippet;
+	}
+	return source;
+}
+
+auto scan_throughput(lox::bench::Runner& runner) -> void {
+	const std::vector<std::pair<std::string, std::string>> corpora = {
+	    {"whitespace", repeat("var x = 1;\n" + std::string(60, ' ') + "\t\t\n\n")},
+	    {"comments", repeat("// " + std::string(100, '=') + " generated section header\nx;\n")},
+	    {"identifiers", repeat("some_fairly_long_identifier_name = another_long_identifier_name_2 + x;\n")},
+	    {"strings", repeat("print \"a string literal that is long enough to span a few vectors\";\n")},
+	    {"numbers", repeat("total = 1234567890.0987654321 * 31415926535 - 2718281828;\n")},
+	};
+	const std::vector<std::pair<std::string, lox::SimdLevel>> levels = {
+	    {"scalar", lox::SimdLevel::scalar}, {"sse2", lox::SimdLevel::sse2}, {"avx2", lox::SimdLevel::avx2}};
+
+	for (const auto& [corpus, source] : corpora) {
+		for (const auto& [level_name, level] : levels) {
+			const auto& kernels = lox::scan_kernels(level);
+			if (kernels.level != level) {
+				continue;  // not supported on this CPU
+			}
+			runner.measure(
+			    "scanner/" + corpus + "/" + level_name, source.size(),
+			    [&] {
+				    lox::Scanner scanner{source, kernels};
+				    lox::bench::do_not_optimize(scanner.scan_tokens().size());
+			    },
+			    lox::bench::Unit::bytes);
+		}
+	}
+}
+LOX_BENCHMARK(scan_throughput);
+
+}  // namespace
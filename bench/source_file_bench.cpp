@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <lox/scanner.hpp>
+#include <lox/source_file.hpp>
+
+namespace {
+
+// Reading a script into a string first versus scanning the mapped file
+auto file_loading(lox::bench::Runner& runner) -> void {
+	if (!runner.wants("load/")) {
+		return;
+	}
+	auto path = std::filesystem::temp_directory_path() / "lox_bench_source.lox";
+	{
+		std::ofstream out(path, std::ios::binary);
+		for (int i = 0; i < 400'000; i++) {
+			out << "var v" << i << " = (a + " << i << ") * \"text\"; // generated\n";
+		}
+	}
+	auto size = std::filesystem::file_size(path);
+
+	runner.measure(
+	    "load/read_into_string", size,
+	    [&] {
+		    std::ifstream in(path, std::ios::binary);
+		    std::ostringstream contents;
+		    contents << in.rdbuf();
+		    std::string source = std::move(contents).str();
+		    lox::Scanner scanner{source};
+		    lox::bench::do_not_optimize(scanner.scan_tokens().size());
+	    },
+	    lox::bench::Unit::bytes);
+
+	runner.measure(
+	    "load/source_file", size,
+	    [&] {
+		    auto source = lox::SourceFile::open(path);
+		    lox::Scanner scanner{source.view()};
+		    lox::bench::do_not_optimize(scanner.scan_tokens().size());
+	    },
+	    lox::bench::Unit::bytes);
+
+	std::filesystem::remove(path);
+}
+LOX_BENCHMARK(file_loading);
+
+}  // namespace
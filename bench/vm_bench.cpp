@@ -0,0 +1,39 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+namespace {
+
+auto compile(const std::string& source) -> lox::Chunk {
+	lox::Scanner scanner{source};
+	std::vector<lox::Token> tokens = scanner.scan_tokens();
+	lox::Parser parser{tokens};
+	return lox::Compiler{}.compile(parser.parse());
+}
+
+auto hot_loops(lox::bench::Runner& runner) -> void {
+	constexpr int iterations = 100'000;
+	auto locals              = compile("{ var sum = 0; for (var i = 0; i < " + std::to_string(iterations) +
+	                                   "; i = i + 1) { sum = sum + i * 2 - 1; } }");
+	runner.measure("vm/loop/locals", iterations, [&] {
+		lox::VM vm;
+		vm.run(locals);
+	});
+
+	auto globals = compile("var sum = 0; for (var i = 0; i < " + std::to_string(iterations) +
+	                       "; i = i + 1) { sum = sum + i * 2 - 1; }");
+	runner.measure("vm/loop/globals", iterations, [&] {
+		lox::VM vm;
+		vm.run(globals);
+	});
+}
+LOX_BENCHMARK(hot_loops);
+
+}  // namespace
@@ -0,0 +1,95 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// Bump allocator owning every AST node of a parse.
+// Nodes are carved out of large blocks and released together when the arena is dropped,
+// so node types must be trivially destructible.
+class Arena {
+private:
+	static constexpr std::size_t default_block_size = 64 * 1024;
+
+	std::vector<std::unique_ptr<std::byte[]>> blocks_;
+	std::byte* cursor_ = nullptr;
+	std::byte* limit_  = nullptr;
+	std::size_t block_size_;
+
+	std::size_t bytes_allocated_ = 0;
+	std::size_t allocations_     = 0;
+
+	auto grow(std::size_t size, std::size_t align) -> void;
+
+public:
+	explicit Arena(std::size_t block_size = default_block_size) : block_size_(block_size) {}
+
+	Arena(const Arena&)                    = delete;
+	auto operator=(const Arena&) -> Arena& = delete;
+	// The moved-from arena is left empty, its cursor must not point into blocks it no longer owns
+	Arena(Arena&& other) noexcept
+	    : blocks_(std::move(other.blocks_)), cursor_(std::exchange(other.cursor_, nullptr)),
+	      limit_(std::exchange(other.limit_, nullptr)), block_size_(other.block_size_),
+	      bytes_allocated_(std::exchange(other.bytes_allocated_, 0)),
+	      allocations_(std::exchange(other.allocations_, 0)) {
+		other.blocks_.clear();
+	}
+	auto operator=(Arena&& other) noexcept -> Arena& {
+		if (this != &other) {
+			blocks_          = std::move(other.blocks_);
+			cursor_          = std::exchange(other.cursor_, nullptr);
+			limit_           = std::exchange(other.limit_, nullptr);
+			block_size_      = other.block_size_;
+			bytes_allocated_ = std::exchange(other.bytes_allocated_, 0);
+			allocations_     = std::exchange(other.allocations_, 0);
+			other.blocks_.clear();
+		}
+		return *this;
+	}
+	~Arena() = default;
+
+	auto allocate(std::size_t size, std::size_t align) -> void* {
+		auto space   = static_cast<std::size_t>(limit_ - cursor_);
+		void* result = cursor_;
+		if (cursor_ == nullptr || std::align(align, size, result, space) == nullptr) {
+			grow(size, align);
+			result = cursor_;
+		}
+		cursor_ = static_cast<std::byte*>(result) + size;
+		bytes_allocated_ += size;
+		allocations_++;
+		return result;
+	}
+
+	template <typename T, typename... Args>
+	auto make(Args&&... args) -> T* {
+		static_assert(std::is_trivially_destructible_v<T>, "arena nodes are never destroyed individually");
+		return ::new (allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+	}
+
+	// Copies a run of nodes into the arena, used for statement lists
+	template <typename T>
+	auto make_array(std::span<const T> items) -> std::span<T> {
+		static_assert(std::is_trivially_destructible_v<T>, "arena nodes are never destroyed individually");
+		auto* first = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+		std::uninitialized_copy(items.begin(), items.end(), first);
+		return {first, items.size()};
+	}
+
+	// Drops every node but keeps the first block around for reuse
+	auto reset() -> void;
+
+	[[nodiscard]] auto bytes_allocated() const -> std::size_t { return bytes_allocated_; }
+	[[nodiscard]] auto allocations() const -> std::size_t { return allocations_; }
+	[[nodiscard]] auto block_count() const -> std::size_t { return blocks_.size(); }
+};
+
+}  // namespace lox
+#endif
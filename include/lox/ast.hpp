@@ -1,46 +1,47 @@
 #ifndef AST_HPP
 #define AST_HPP
+#include "arena.hpp"
+#include "instrument.hpp"
 #include "tokens.hpp"
 
-#include <memory>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace lox {
 
-// Value semantic wrapper inspired by rust Box type
+// Handle to a node living in an Arena, inspired by rust Box type
+// Copying a Box copies the pointer, the node itself is owned and freed by the arena
 template <typename T>
 class Box {
-	// Wrapper over unique_ptr
-	// Is used to make value semantic on top of unique pointer
 private:
-	std::unique_ptr<T> impl_;
+	T* impl_;
 
 public:
-	// Automatic construction from a T, not a T*
-	// takes value type and basically puts it into a unique_ptr
-	Box(T&& obj) : impl_(std::make_unique<T>(std::move(obj))) {}
-
-	Box(const T& obj) : impl_(std::make_unique<T>(std::move(obj))) {}
-
-	// Copy constructor copies T
-	Box(const Box& other) : Box(*other.impl_) {}
-
-	Box& operator=(const Box& other) {
-		*impl_ = *other.impl_;
-		return *this;
-	}
-
-	~Box() = default;
+	explicit Box(T* obj) : impl_(obj) {}
 
 	T& operator*() { return *impl_; }
 
 	const T& operator*() const { return *impl_; }
 
-	T* operator->() { return impl_.get(); }
+	T* operator->() { return impl_; }
+
+	const T* operator->() const { return impl_; }
 
-	const T* operator->() const { return impl_.get(); }
+	[[nodiscard]] auto get() const -> T* { return impl_; }
 };
 
+// Moves a node into the arena and hands back its Box
+template <typename T>
+auto make_box(Arena& arena, T&& node) -> Box<std::remove_cvref_t<T>> {
+	LOX_INSTRUMENT_COUNT(box_allocations, 1);
+	LOX_INSTRUMENT_COUNT(box_bytes, sizeof(std::remove_cvref_t<T>));
+	return Box<std::remove_cvref_t<T>>{arena.make<std::remove_cvref_t<T>>(std::forward<T>(node))};
+}
+
 struct Unary;
 struct Binary;
 struct Grouping;
@@ -51,8 +52,29 @@ struct Print;
 struct Var;
 struct Logical;
 struct Get;
+struct Set;
+struct Call;
+struct Assign;
+struct Block;
+struct If;
+struct While;
+struct Class;
+
+// Where a variable lives, filled in by the Resolver.
+// Locals are stack slots of the frame, depth counts the scopes between the use and the declaration.
+// Globals are slots of the compilation's global table, their depth is the distance to the top level.
+struct Binding {
+	enum class Kind : std::uint8_t { unresolved, local, global };
+
+	Kind kind          = Kind::unresolved;
+	std::uint16_t depth = 0;
+	std::uint16_t slot  = 0;
+};
+
+using Expr = std::variant<Box<Unary>, Box<Binary>, Box<Grouping>, Box<Literal>, Box<Variable>, Box<Logical>, Box<Get>,
+                          Box<Set>, Box<Call>, Box<Assign>>;
 
-using Expr = std::variant<Box<Unary>, Box<Binary>, Box<Grouping>, Box<Literal>, Box<Variable>, Box<Logical>, Box<Get>>;
+using Stmt = std::variant<Box<Expression>, Box<Print>, Box<Var>, Box<Block>, Box<If>, Box<While>, Box<Class>>;
 
 struct Logical {
 	Expr left, right;
@@ -74,6 +96,7 @@ struct Literal {
 
 struct Variable {
 	Token token;
+	Binding binding{};
 };
 
 struct Expression {
@@ -87,6 +110,7 @@ struct Print {
 struct Var {
 	Token token;
 	Expr initializer;
+	Binding binding{};
 };
 
 struct Unary {
@@ -94,8 +118,50 @@ struct Unary {
 	Expr right;
 };
 
+// object.name
 struct Get {
+	Expr object;
+	Token name;
+};
+
+// object.name = value
+struct Set {
+	Expr object;
+	Token name;
+	Expr value;
+};
+
+struct Call {
+	Expr callee;
+	Token paren;  // closing parenthesis, locates runtime errors
+	std::span<Expr> arguments;
+};
+
+struct Assign {
+	Token name;
 	Expr value;
+	Binding binding{};
+};
+
+struct Block {
+	std::span<Stmt> statements;
+};
+
+struct If {
+	Expr condition;
+	Stmt then_branch;
+	std::optional<Stmt> else_branch;
+};
+
+struct While {
+	Expr condition;
+	Stmt body;
+};
+
+// Declares a variable holding the class, like a Var
+struct Class {
+	Token name;
+	Binding binding{};
 };
 
 }  // namespace mirscript
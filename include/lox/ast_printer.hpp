@@ -2,37 +2,37 @@
 #define AST_PRINTER_HPP
 #include "lox/ast.hpp"
 
-class ASTPrinter
+namespace lox
 {
-private:
-public:
-    ASTPrinter() = default;
-    ~ASTPrinter() = default;
-
-    void operator(const Unary &unary)
+    class ASTPrinter
     {
-        std::cout << "Got unary" << std::endl;
-    }
+    private:
+    public:
+        ASTPrinter() = default;
+        ~ASTPrinter() = default;
 
-    void operator(const Binary &binary)
-    {
-        std::cout << "Got Binary" << std::endl;
-    }
+        void print(const Expr &expr);
 
-    void operator(const Grouping &grouping)
-    {
-        std::cout << "Got Grouping" << std::endl;
-    }
+        void operator()(const Unary &unary);
 
-    void operator(const Literal &literal)
-    {
-        std::cout << "Got Literal" << std::endl;
-    }
+        void operator()(const Binary &binary);
 
-    void operator(const Variable &variable)
-    {
-        std::cout << "Got Variable" << std::endl;
-    }
-};
+        void operator()(const Grouping &grouping);
+
+        void operator()(const Literal &literal);
+
+        void operator()(const Variable &variable);
+
+        void operator()(const Logical &logical);
+
+        void operator()(const Get &get);
+
+        void operator()(const Set &set);
+
+        void operator()(const Call &call);
+
+        void operator()(const Assign &assign);
+    };
+}
 
-#endif
\ No newline at end of file
+#endif
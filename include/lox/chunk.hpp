@@ -0,0 +1,116 @@
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+#include "lox/tokens.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// One byte opcodes, operands follow inline in the code stream.
+// u8 operands are local slots, u16 operands are constant indices, global slots and jump offsets (big endian).
+enum class OpCode : std::uint8_t {
+	constant_op,       // u16 constant index
+	nil_op,
+	true_op,
+	false_op,
+	pop_op,
+	get_local_op,      // u8 slot
+	set_local_op,      // u8 slot
+	get_global_op,     // u16 global slot
+	define_global_op,  // u16 global slot
+	set_global_op,     // u16 global slot
+	get_property_op,   // u16 name constant, u16 inline cache
+	set_property_op,   // u16 name constant, u16 inline cache
+	equal_op,
+	greater_op,
+	less_op,
+	add_op,
+	subtract_op,
+	multiply_op,
+	divide_op,
+	not_op,
+	negate_op,
+	print_op,
+	jump_op,           // u16 forward offset
+	jump_if_false_op,  // u16 forward offset, leaves the condition on the stack
+	loop_op,           // u16 backward offset
+	call_op,           // u8 argument count
+	class_op,          // u16 name constant
+	// Superinstructions, each does the work of the sequence in its comment
+	add_local_op,          // u8 slot: get_local_op, add_op
+	add_constant_op,       // u16 constant index: constant_op, add_op
+	equal_constant_op,     // u16 constant index: constant_op, equal_op
+	greater_constant_op,   // u16 constant index: constant_op, greater_op
+	less_constant_op,      // u16 constant index: constant_op, less_op
+	pop_jump_if_false_op,  // u16 forward offset: jump_if_false_op, pop_op on both paths
+	// Precedes the code of a side effect free arithmetic expression the VM may run as native code instead
+	jit_region_op,  // u16 region index, u16 length of the expression's code
+	// Must stay last, opcode_count depends on it
+	return_op
+};
+
+inline constexpr std::size_t opcode_count = static_cast<std::size_t>(OpCode::return_op) + 1;
+
+// Bytes taken by an instruction's operands, the next instruction starts behind them
+[[nodiscard]] constexpr auto operand_size(OpCode op) -> std::size_t {
+	switch (op) {
+		case OpCode::get_local_op:
+		case OpCode::set_local_op:
+		case OpCode::call_op:
+		case OpCode::add_local_op:
+			return 1;
+		case OpCode::nil_op:
+		case OpCode::true_op:
+		case OpCode::false_op:
+		case OpCode::pop_op:
+		case OpCode::equal_op:
+		case OpCode::greater_op:
+		case OpCode::less_op:
+		case OpCode::add_op:
+		case OpCode::subtract_op:
+		case OpCode::multiply_op:
+		case OpCode::divide_op:
+		case OpCode::not_op:
+		case OpCode::negate_op:
+		case OpCode::print_op:
+		case OpCode::return_op:
+			return 0;
+		case OpCode::get_property_op:
+		case OpCode::set_property_op:
+		case OpCode::jit_region_op:
+			return 4;
+		default:
+			return 2;
+	}
+}
+
+// Compiled bytecode together with its constant pool and a line per code byte for error reporting
+struct Chunk {
+	std::vector<std::uint8_t> code;
+	std::vector<unsigned int> lines;
+	std::vector<EvalResult> constants;
+	// Name constant of each global slot
+	std::vector<std::uint16_t> globals;
+	// Property access sites, each gets its own inline cache in the VM running the chunk
+	std::uint16_t inline_caches = 0;
+	// Expressions marked by jit_region_op
+	std::uint16_t jit_regions = 0;
+
+	auto write(std::uint8_t byte, unsigned int line) -> void {
+		code.push_back(byte);
+		lines.push_back(line);
+	}
+
+	auto write(OpCode op, unsigned int line) -> void { write(static_cast<std::uint8_t>(op), line); }
+
+	auto add_constant(EvalResult value) -> std::size_t {
+		constants.push_back(std::move(value));
+		return constants.size() - 1;
+	}
+};
+
+}  // namespace lox
+#endif
@@ -0,0 +1,53 @@
+#ifndef CHUNK_CACHE_HPP
+#define CHUNK_CACHE_HPP
+#include "lox/chunk.hpp"
+#include "lox/diagnostics.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace lox {
+
+// 64 bit hash of a script's text, read 8 bytes at a time so checking a script against the cache
+// costs a fraction of scanning it
+[[nodiscard]] auto content_hash(std::string_view source) -> std::uint64_t;
+
+// Flat binary image of a Chunk: a fixed header naming the source hash and size, then the code, lines,
+// global slots, constants and a string pool back to back. Loading checks the header and sizes,
+// copies the arrays out in bulk and rebuilds only the string constants.
+[[nodiscard]] auto serialize(const Chunk& chunk, std::string_view source) -> std::string;
+// Returns nothing when the image is truncated, from another format version, compiled from another source
+// or refers to constants, globals or code it doesn't have
+[[nodiscard]] auto deserialize(std::span<const char> image, std::string_view source) -> std::optional<Chunk>;
+
+// Directory of compiled scripts named after their content hash, so an edited script simply misses
+// and unchanged ones skip the Scanner, Parser and Compiler. Entries are memory mapped when loaded.
+// The cache is only an accelerator: unreadable, truncated or unwritable entries behave like misses, as do
+// entries whose code or globals refer past their own tables and every entry on big endian hosts.
+// The stack use of the code is trusted, the directory must not be writable by others.
+class ChunkCache {
+private:
+	std::filesystem::path directory_;
+
+public:
+	// Creates the directory when it is missing
+	explicit ChunkCache(std::filesystem::path directory);
+
+	[[nodiscard]] auto path_for(std::string_view source) const -> std::filesystem::path;
+
+	[[nodiscard]] auto load(std::string_view source) const -> std::optional<Chunk>;
+	// Written to a temporary file and renamed, concurrent runs never see a partial entry
+	auto store(std::string_view source, const Chunk& chunk) const -> bool;
+
+	// Loads the cached chunk, or scans, parses and compiles the source and caches the result.
+	// Returns every lexical and syntax error like parse_program
+	[[nodiscard]] auto compile(std::string_view source) const -> std::expected<Chunk, Diagnostics>;
+};
+
+}  // namespace lox
+#endif
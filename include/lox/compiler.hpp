@@ -0,0 +1,90 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+#include "lox/ast.hpp"
+#include "lox/chunk.hpp"
+#include "lox/jit.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// Code generator from the AST to a Chunk, run after the Resolver has bound every variable.
+// Block scoped variables live in stack slots, top level variables in the chunk's global slots.
+class Compiler {
+private:
+	Chunk chunk_;
+	// Scope depth of each live local, popped when its block ends
+	std::vector<int> local_depths_;
+	// Variable names and string literals share one constant per distinct text
+	std::unordered_map<std::string_view, std::uint16_t> strings_;
+	int scope_depth_   = 0;
+	unsigned int line_ = 0;
+	// Start of the last emitted instruction, and the last offset a jump lands on.
+	// An instruction can only be fused with the previous one when no jump lands between them
+	std::size_t last_instruction_ = 0;
+	std::size_t jump_target_      = 0;
+	// Whether expressions are marked with jit_region_op, set while compiling the code of one, regions don't nest
+	bool jit_regions_   = false;
+	bool in_jit_region_ = false;
+
+	auto statement(const Stmt& stmt) -> void;
+	auto expression(const Expr& expr) -> void;
+
+	auto visit(const Expression& stmt) -> void;
+	auto visit(const Print& stmt) -> void;
+	auto visit(const Var& stmt) -> void;
+	auto visit(const Block& stmt) -> void;
+	auto visit(const If& stmt) -> void;
+	auto visit(const While& stmt) -> void;
+	auto visit(const Class& stmt) -> void;
+
+	auto visit(const Unary& expr) -> void;
+	auto visit(const Binary& expr) -> void;
+	auto visit(const Grouping& expr) -> void;
+	auto visit(const Literal& expr) -> void;
+	auto visit(const Variable& expr) -> void;
+	auto visit(const Logical& expr) -> void;
+	auto visit(const Get& expr) -> void;
+	auto visit(const Set& expr) -> void;
+	auto visit(const Call& expr) -> void;
+	auto visit(const Assign& expr) -> void;
+
+	auto emit(OpCode op) -> void {
+		last_instruction_ = chunk_.code.size();
+		chunk_.write(op, line_);
+	}
+	auto emit(OpCode op, std::uint8_t operand) -> void;
+	auto emit_u16(OpCode op, std::size_t operand) -> void;
+	auto emit_constant(EvalResult value) -> void;
+	auto emit_jump(OpCode op) -> std::size_t;
+	auto patch_jump(std::size_t operand) -> void;
+	auto emit_loop(std::size_t loop_start) -> void;
+	auto mark_loop_start() -> std::size_t;
+	auto fuse(OpCode previous, OpCode fused) -> bool;
+	auto emit_fused(OpCode op) -> void;
+	auto emit_property(OpCode op, const Token& name) -> void;
+	auto jit_region(const Expr& expr) -> void;
+
+	auto string_constant(std::string_view text) -> std::uint16_t;
+	auto link_globals(std::span<const std::string_view> names) -> void;
+	auto begin_scope() -> void { scope_depth_++; }
+	auto end_scope() -> void;
+
+public:
+	Compiler() = default;
+	// Marks JIT regions when jit is enabled and native code is supported, for VMs running with it enabled
+	explicit Compiler(JitConfig jit) : jit_regions_(jit.enabled && jit_supported()) {}
+
+	// Resolves the tree in place, then compiles it.
+	// The value of a trailing expression statement becomes the result of the chunk
+	auto compile(std::span<Stmt> program) -> Chunk;
+	auto compile(Expr& expr) -> Chunk;
+};
+
+}  // namespace lox
+#endif
@@ -0,0 +1,59 @@
+#ifndef CONSTANT_FOLDER_HPP
+#define CONSTANT_FOLDER_HPP
+#include "lox/arena.hpp"
+#include "lox/ast.hpp"
+
+#include <cstddef>
+#include <span>
+
+namespace lox {
+
+// Optimization pass rewriting a parsed tree in place before it is compiled.
+// Operators whose operands are all literals become a single Literal, Grouping nodes are dropped
+// and `and`/`or` with a literal left operand collapse to the operand the VM would pick.
+// Only operations that can't fail are folded, a type error like -"text" is left for the VM to report.
+class ConstantFolder {
+private:
+	// Folded literals and concatenated strings live here, it must outlive the tree
+	Arena* arena_;
+	std::size_t eliminated_ = 0;
+
+	auto statement(Stmt& stmt) -> void;
+
+	auto visit(Expression& stmt) -> void;
+	auto visit(Print& stmt) -> void;
+	auto visit(Var& stmt) -> void;
+	auto visit(Block& stmt) -> void;
+	auto visit(If& stmt) -> void;
+	auto visit(While& stmt) -> void;
+	auto visit(Class& stmt) -> void;
+
+	// Each returns the node replacing expr in its parent, expr itself when nothing folded
+	auto rewrite(Box<Unary> expr) -> Expr;
+	auto rewrite(Box<Binary> expr) -> Expr;
+	auto rewrite(Box<Grouping> expr) -> Expr;
+	auto rewrite(Box<Literal> expr) -> Expr;
+	auto rewrite(Box<Variable> expr) -> Expr;
+	auto rewrite(Box<Logical> expr) -> Expr;
+	auto rewrite(Box<Get> expr) -> Expr;
+	auto rewrite(Box<Set> expr) -> Expr;
+	auto rewrite(Box<Call> expr) -> Expr;
+	auto rewrite(Box<Assign> expr) -> Expr;
+
+	auto literal(LiteralType value) -> Expr;
+
+public:
+	explicit ConstantFolder(Arena& arena) : arena_(&arena) {}
+
+	auto fold(std::span<Stmt> program) -> void;
+	auto fold(Expr& expr) -> void;
+
+	// Nodes removed from the trees folded so far
+	[[nodiscard]] auto eliminated() const -> std::size_t { return eliminated_; }
+};
+
+// Number of nodes in an expression tree
+[[nodiscard]] auto count_nodes(const Expr& expr) -> std::size_t;
+
+}  // namespace lox
+#endif
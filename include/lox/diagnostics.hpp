@@ -0,0 +1,64 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+enum class DiagnosticCode : std::uint8_t {
+	unexpected_character,
+	unterminated_string,
+	expected_expression,
+	// A required token such as ';' or ')' is missing, the message names it
+	expected_token,
+	invalid_assignment_target,
+	too_many_arguments,
+};
+
+// One error located in the source. Lines and columns count from 0 like Token lines,
+// offset and length delimit the offending text. Messages are string literals.
+struct Diagnostic {
+	DiagnosticCode code;
+	unsigned int line;
+	unsigned int column;
+	unsigned int offset;
+	unsigned int length;
+	std::string_view message;
+};
+
+// Sink the Scanner and Parser report errors into instead of throwing or printing.
+// Reporting copies a few integers, text is only produced when a caller formats a Diagnostic.
+class Diagnostics {
+private:
+	std::string_view source_;
+	std::vector<Diagnostic> entries_;
+	// Offset of the last report and the start of its line. Reports mostly move forward, so finding the
+	// line start of the next one only searches the text in between instead of the whole line
+	unsigned int searched_   = 0;
+	unsigned int line_start_ = 0;
+
+	auto column_of(unsigned int offset) -> unsigned int;
+
+public:
+	// Without the source, offsets and columns of reported spans can't be resolved and are 0
+	explicit Diagnostics(std::string_view source = {}) : source_(source) {}
+
+	// span must point into the source, an empty span marks a position such as the end of input
+	auto report(DiagnosticCode code, std::string_view span, unsigned int line, std::string_view message) -> void;
+
+	[[nodiscard]] auto entries() const -> std::span<const Diagnostic> { return entries_; }
+	[[nodiscard]] auto has_errors() const -> bool { return !entries_.empty(); }
+	[[nodiscard]] auto error_count() const -> std::size_t { return entries_.size(); }
+	[[nodiscard]] auto source() const -> std::string_view { return source_; }
+
+	// "[line 3:7] Error at 'x': message", quoting the offending source text when it is known
+	[[nodiscard]] auto format(const Diagnostic& diagnostic) const -> std::string;
+};
+
+}  // namespace lox
+#endif
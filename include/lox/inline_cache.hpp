@@ -0,0 +1,61 @@
+#ifndef INLINE_CACHE_HPP
+#define INLINE_CACHE_HPP
+#include "lox/object.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace lox {
+
+// Remembers the slots a get_property_op or set_property_op site found, keyed by the receiver's Shape.
+// A site is monomorphic after its first lookup and polymorphic once it has seen up to `ways` shapes.
+// A shape beyond that makes it megamorphic: the entries are kept and every other shape is looked up again.
+struct PropertyCache {
+	static constexpr std::size_t ways = 4;
+
+	struct Entry {
+		const Shape* shape = nullptr;
+		// Shape of the receiver after the access, differs from shape when a set adds the field
+		Shape* next        = nullptr;
+		std::uint32_t slot = 0;
+	};
+
+	std::array<Entry, ways> entries{};
+	std::uint8_t size = 0;
+
+	[[nodiscard]] auto lookup(const Shape* shape) const -> const Entry* {
+		for (std::uint8_t i = 0; i < size; i++) {
+			if (entries[i].shape == shape) {
+				return &entries[i];
+			}
+		}
+		return nullptr;
+	}
+
+	[[nodiscard]] auto full() const -> bool { return size == ways; }
+
+	// Ignored once the cache is full
+	auto add(Entry entry) -> void {
+		if (!full()) {
+			entries[size++] = entry;
+		}
+	}
+};
+
+// Counters over every property access a VM executed
+struct IcStats {
+	std::size_t monomorphic_hits   = 0;  // the receiver had the shape the site saw first
+	std::size_t polymorphic_hits   = 0;  // the receiver had one of the other cached shapes
+	std::size_t misses             = 0;  // looked up and added to the site's cache
+	std::size_t megamorphic_misses = 0;  // looked up at a site without room left
+
+	[[nodiscard]] auto hits() const -> std::size_t { return monomorphic_hits + polymorphic_hits; }
+	[[nodiscard]] auto lookups() const -> std::size_t { return hits() + misses + megamorphic_misses; }
+	[[nodiscard]] auto hit_rate() const -> double {
+		return lookups() == 0 ? 0.0 : static_cast<double>(hits()) / static_cast<double>(lookups());
+	}
+};
+
+}  // namespace lox
+#endif
@@ -0,0 +1,106 @@
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Optional profiling of the library's own phases, enabled with -DLOX_INSTRUMENT=ON.
+// Without it the LOX_INSTRUMENT_* macros expand to nothing and the hot paths are unchanged;
+// the functions below still exist so callers build either way, they report zeros and an empty trace.
+
+namespace lox::instrument {
+
+#ifdef LOX_INSTRUMENT
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class Counter : std::uint8_t {
+	tokens,           // tokens handed out by a Scanner
+	ast_nodes,        // expression and statement nodes built by a Parser
+	box_allocations,  // make_box calls, by the parser and the passes rewriting the tree
+	box_bytes,        // bytes of those nodes
+};
+
+inline constexpr std::size_t counter_count = 4;
+
+// Totals over every thread since the start or the last reset()
+struct Counts {
+	std::uint64_t tokens          = 0;
+	std::uint64_t ast_nodes       = 0;
+	std::uint64_t box_allocations = 0;
+	std::uint64_t box_bytes       = 0;
+};
+
+// Each thread bumps its own counters; only that thread writes them, so no locked instruction is needed,
+// and they are atomics only so counts() can read them from another thread
+struct ThreadCounters {
+	std::array<std::atomic<std::uint64_t>, counter_count> values{};
+	// Small number naming the thread in the trace, in order of first use
+	std::uint32_t id;
+
+	ThreadCounters();
+	~ThreadCounters();
+	ThreadCounters(const ThreadCounters&)                    = delete;
+	auto operator=(const ThreadCounters&) -> ThreadCounters& = delete;
+};
+
+inline auto thread_counters() -> ThreadCounters& {
+	thread_local ThreadCounters counters;
+	return counters;
+}
+
+inline auto add(Counter counter, std::uint64_t amount) -> void {
+	auto& value = thread_counters().values[static_cast<std::size_t>(counter)];
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+[[nodiscard]] auto counts() -> Counts;
+
+// Clears the counters and the recorded phases
+auto reset() -> void;
+
+// Times a phase from construction to destruction and records it with the counters of this thread it moved
+class Scope {
+private:
+	const char* category_;
+	const char* name_;
+	std::array<std::uint64_t, counter_count> counts_at_start_;
+	std::chrono::steady_clock::time_point start_;
+
+public:
+	// Both strings must be literals, they are kept until the trace is written
+	Scope(const char* category, const char* name);
+	~Scope();
+	Scope(const Scope&)                    = delete;
+	auto operator=(const Scope&) -> Scope& = delete;
+};
+
+// Number of phases recorded since the start or the last reset()
+[[nodiscard]] auto event_count() -> std::size_t;
+
+// Writes every recorded phase as a Chrome trace-event JSON file, loadable in chrome://tracing or Perfetto.
+// Phases are complete ("X") events carrying their counter deltas as args, the totals follow as a counter event.
+auto write_chrome_trace(std::ostream& out) -> void;
+
+}  // namespace lox::instrument
+
+#define LOX_INSTRUMENT_CONCAT_(a, b) a##b
+#define LOX_INSTRUMENT_CONCAT(a, b) LOX_INSTRUMENT_CONCAT_(a, b)
+
+#ifdef LOX_INSTRUMENT
+#define LOX_INSTRUMENT_COUNT(counter, amount) \
+	::lox::instrument::add(::lox::instrument::Counter::counter, static_cast<std::uint64_t>(amount))
+#define LOX_INSTRUMENT_SCOPE(category, name) \
+	const ::lox::instrument::Scope LOX_INSTRUMENT_CONCAT(lox_instrument_scope_, __LINE__) { category, name }
+#else
+#define LOX_INSTRUMENT_COUNT(counter, amount) static_cast<void>(0)
+#define LOX_INSTRUMENT_SCOPE(category, name) static_cast<void>(0)
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+#include "lox/value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace lox {
+
+// Native code tier for arithmetic.
+// A Compiler given an enabled JitConfig marks side effect free expressions of numbers, comparisons and
+// logical operators with jit_region_op. Once a region has been interpreted hot_threshold times the VM
+// translates its bytecode to x86-64, keeping the operand stack in xmm registers. Loads of variables are
+// guarded to be numbers; a failed guard returns jit_guard_failed and the VM interprets the region instead,
+// which is safe because the region has no side effects. Regions the JIT can't type statically are left to
+// the interpreter.
+struct JitConfig {
+	// Runtime switch, regions are always interpreted when off.
+	// Given to the Compiler it marks the regions, so chunks compiled with it off don't change
+	bool enabled = false;
+	std::uint32_t hot_threshold = 16;
+	// Native code is dropped after this many failed guards, the region stays interpreted from then on
+	std::uint32_t max_guard_failures = 8;
+};
+
+struct JitStats {
+	std::size_t compiled       = 0;  // regions turned into native code
+	std::size_t rejected       = 0;  // hot regions the JIT could not translate
+	std::size_t native_runs    = 0;  // executions that completed in native code
+	std::size_t guard_failures = 0;  // native executions that fell back to the interpreter
+	std::size_t deoptimized    = 0;  // regions whose native code was dropped
+};
+
+// Returned instead of a value when a guard fails, Value::empty() is never a Lox value
+inline constexpr std::uint64_t jit_guard_failed = Value::empty().bits();
+
+// Native code of one region, reads locals through the stack base it is called with
+using JitFunction = std::uint64_t (*)(const Value* locals);
+
+// Executable mapping of one compiled region, written before it is made executable and never after
+class JitCode {
+private:
+	void* memory_     = nullptr;
+	std::size_t size_ = 0;
+
+public:
+	JitCode() = default;
+	JitCode(void* memory, std::size_t size) : memory_(memory), size_(size) {}
+	JitCode(const JitCode&)                    = delete;
+	auto operator=(const JitCode&) -> JitCode& = delete;
+	JitCode(JitCode&& other) noexcept;
+	auto operator=(JitCode&& other) noexcept -> JitCode&;
+	~JitCode();
+
+	[[nodiscard]] auto entry() const -> JitFunction { return reinterpret_cast<JitFunction>(memory_); }
+	[[nodiscard]] auto size() const -> std::size_t { return size_; }
+};
+
+// True when this build can generate native code (x86-64 Linux with LOX_JIT)
+[[nodiscard]] auto jit_supported() -> bool;
+
+// Translates the code of one region: constants are the running chunk's pool, globals its global slots.
+// Returns nothing for unsupported instructions, operands of the wrong type or stacks deeper than the registers
+[[nodiscard]] auto jit_compile(std::span<const std::uint8_t> code, std::span<const Value> constants,
+                               std::span<Value* const> globals) -> std::optional<JitCode>;
+
+}  // namespace lox
+#endif
@@ -10,9 +10,9 @@ private:
 public:
     LoxException(const std::string &message) : message_(message) {}
 
-    char *what()
+    auto what() const noexcept -> const char * override
     {
-        return message_.data();
+        return message_.c_str();
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+#ifndef OBJECT_HPP
+#define OBJECT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+class Value;
+
+enum class ObjType : std::uint8_t { string_obj, class_obj, instance_obj };
+
+// Header shared by every heap allocated runtime object, objects are chained for the owning Heap.
+// An object is marked when its mark equals the heap's current mark bit, flipping the bit unmarks everything.
+struct Obj {
+	ObjType type;
+	bool marked = false;
+	Obj* next   = nullptr;
+};
+
+struct ObjString : Obj {
+	std::string chars;
+
+	explicit ObjString(std::string text) : Obj{ObjType::string_obj}, chars(std::move(text)) {}
+};
+
+struct ObjClass : Obj {
+	ObjString* name;
+
+	explicit ObjClass(ObjString* class_name) : Obj{ObjType::class_obj}, name(class_name) {}
+};
+
+// Hidden class: the ordered field names an instance has, instances built by adding the same names
+// in the same order share a Shape. Shapes form a tree rooted at the empty shape, each edge adds one name,
+// so a property's slot only depends on the shape and inline caches can key on the shape pointer.
+struct Shape {
+	Shape* parent = nullptr;
+	// Name of the slot this shape added, its keys are the parent's plus this one
+	ObjString* key = nullptr;
+	std::vector<ObjString*> keys;
+	std::vector<std::pair<ObjString*, Shape*>> transitions;
+
+	// Slot of the field with this name, -1 when the shape has none
+	[[nodiscard]] auto find(const ObjString* name) const -> int {
+		for (std::size_t slot = 0; slot < keys.size(); slot++) {
+			if (keys[slot] == name) {
+				return static_cast<int>(slot);
+			}
+		}
+		return -1;
+	}
+};
+
+// Fields are stored by slot in the order of the shape's keys.
+// Members are defined in object.cpp, where Value is complete
+struct ObjInstance : Obj {
+	ObjClass* klass;
+	Shape* shape;
+	std::vector<Value> fields;
+
+	ObjInstance(ObjClass* instance_class, Shape* empty);
+	~ObjInstance();
+};
+
+enum class GcMode : std::uint8_t {
+	// Each collection marks and sweeps the whole heap in one pause
+	stop_the_world,
+	// Tri-color marking and sweeping in bounded steps interleaved with allocations
+	incremental,
+};
+
+// Tuning knobs of the collector
+struct GcConfig {
+	GcMode mode = GcMode::stop_the_world;
+	// Bytes allocated before the first collection
+	std::size_t initial_heap_size = 1024 * 1024;
+	// After a collection the next one runs once the surviving bytes have grown by this factor
+	double growth_factor = 2.0;
+	// Collect before every allocation, flushes out missing roots in tests
+	bool stress = false;
+	// Incremental mode: objects traced or swept by the step each allocation performs during a cycle
+	std::size_t step_budget = 256;
+	// Called with the length of every pause, collections and incremental steps alike
+	std::function<void(std::chrono::nanoseconds)> on_pause{};
+};
+
+struct GcStats {
+	std::size_t bytes_allocated = 0;  // currently held by live and not yet collected objects
+	std::size_t next_gc         = 0;  // bytes_allocated that triggers the next collection
+	std::size_t collections     = 0;  // completed cycles
+	std::size_t steps           = 0;  // incremental steps, including the ones finishing a cycle
+	std::size_t objects_freed   = 0;
+	std::size_t bytes_freed     = 0;
+	std::chrono::nanoseconds last_pause{};
+	std::chrono::nanoseconds max_pause{};
+	std::chrono::nanoseconds total_pause{};
+};
+
+// Owns every runtime object created by one VM and reclaims them with a precise mark-sweep collector.
+// Strings are interned: each distinct text exists once, so strings compare and hash by pointer.
+// The owner registers a root marker that marks every object it still references,
+// a collection can run on any allocation so roots must be up to date before allocating.
+//
+// In incremental mode a cycle marks the roots, then traces and sweeps a budget of objects per allocation.
+// Objects allocated during a cycle are black and shade the objects they are made from.
+// The mutator must pass every reference it stores into storage the root marker skips while remarking()
+// through write_barrier(), the rest is rescanned in the pause that ends marking.
+class Heap {
+private:
+	enum class Phase : std::uint8_t { idle, marking, sweeping };
+
+	Obj* objects_ = nullptr;
+	// Weak: keys view the chars of the string they map to, swept strings are removed
+	std::unordered_map<std::string_view, ObjString*> strings_;
+	// Shapes are never freed, there is one per distinct field layout and their names are roots
+	std::vector<std::unique_ptr<Shape>> shapes_;
+	std::vector<Obj*> gray_;
+	std::function<void(Heap&)> mark_roots_;
+	GcConfig config_;
+	GcStats stats_;
+
+	Phase phase_    = Phase::idle;
+	bool mark_bit_  = true;
+	bool remarking_ = false;
+	// Link to the next object to sweep, objects allocated meanwhile are pushed in front of it
+	Obj** sweep_link_ = nullptr;
+
+	auto track(Obj* object, std::size_t size) -> void;
+	auto before_allocation() -> void;
+	auto found_interned(ObjString* string) -> ObjString*;
+	auto begin_cycle() -> void;
+	auto trace(std::size_t budget) -> std::size_t;
+	auto finish_marking() -> void;
+	auto start_sweeping() -> void;
+	auto sweep(std::size_t budget) -> std::size_t;
+	auto finish_cycle() -> void;
+	auto record_pause(std::chrono::steady_clock::time_point start) -> void;
+	auto mark_shapes() -> void;
+	auto blacken(Obj* object) -> void;
+	auto destroy(Obj* object) -> void;
+
+public:
+	explicit Heap(GcConfig config = {});
+	Heap(const Heap&)                    = delete;
+	auto operator=(const Heap&) -> Heap& = delete;
+	~Heap();
+
+	auto set_root_marker(std::function<void(Heap&)> mark_roots) -> void { mark_roots_ = std::move(mark_roots); }
+
+	// The interned string with this text, created on first use
+	auto make_string(std::string text) -> ObjString*;
+	auto intern(std::string_view text) -> ObjString*;
+	auto make_class(ObjString* name) -> ObjClass*;
+	// New instances start with the empty shape and no fields
+	auto make_instance(ObjClass* klass) -> ObjInstance*;
+
+	[[nodiscard]] auto empty_shape() const -> Shape* { return shapes_.front().get(); }
+	// The shape reached by adding name to shape, created on first use
+	auto transition(Shape* shape, ObjString* name) -> Shape*;
+	// Appends a field and moves the instance to next, which must be the transition adding that field.
+	// Never collects, but the value must be passed to write_barrier() like any other store
+	auto add_field(ObjInstance* instance, Shape* next, Value value) -> void;
+
+	// Called by the root marker for everything it holds
+	auto mark(Obj* object) -> void;
+	auto mark(Value value) -> void;
+	// Shades a reference stored into already scanned storage while a cycle is marking
+	auto write_barrier(Value value) -> void;
+	// True while the root marker is called to end incremental marking, barrier protected roots may be skipped
+	[[nodiscard]] auto remarking() const -> bool { return remarking_; }
+
+	// Finishes the running cycle or runs a whole one in a single pause,
+	// also runs automatically once next_gc bytes are allocated in stop the world mode
+	auto collect() -> void;
+	// One bounded incremental step, starts a cycle when none is running
+	auto step() -> void;
+	[[nodiscard]] auto collecting() const -> bool { return phase_ != Phase::idle; }
+
+	[[nodiscard]] auto interned_count() const -> std::size_t { return strings_.size(); }
+	[[nodiscard]] auto stats() const -> const GcStats& { return stats_; }
+	[[nodiscard]] auto config() const -> const GcConfig& { return config_; }
+};
+
+}  // namespace lox
+#endif
@@ -1,9 +1,18 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
+#include "arena.hpp"
 #include "ast.hpp"
+#include "diagnostics.hpp"
+#include "instrument.hpp"
+#include "scanner.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <expected>
 #include <iostream>
 #include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include "lox/lox.hpp"
@@ -12,27 +21,92 @@
 
 namespace lox
 {
+    // Binding power of infix operators, from loosest to tightest
+    enum class Precedence : std::uint8_t
+    {
+        none_prec,
+        assignment_prec, // =
+        or_prec,         // or
+        and_prec,        // and
+        equality_prec,   // == !=
+        comparison_prec, // < > <= >=
+        term_prec,       // + -
+        factor_prec,     // * /
+        unary_prec,      // ! -
+        call_prec,       // . ()
+        primary_prec
+    };
+
     class Parser
     {
     private:
+        using PrefixFn = auto (Parser::*)() -> Expr;
+        using InfixFn = auto (Parser::*)(Expr left) -> Expr;
+
+        // One row per TokenType: what the token does at the start of an operand and after one
+        struct ParseRule
+        {
+            PrefixFn prefix = nullptr;
+            InfixFn infix = nullptr;
+            Precedence precedence = Precedence::none_prec;
+        };
+
+        [[nodiscard]] static auto rule(TokenType type) -> const ParseRule &;
+
         std::span<Token> tokens_;
         int current_ = 0;
+        // Streaming mode pulls tokens from the scanner and only keeps a two token window
+        Scanner *scanner_ = nullptr;
+        std::optional<Token> previous_token_;
+        std::optional<Token> current_token_;
         std::vector<Expr> expressions_;
+        std::vector<Stmt> statements_;
+        Arena own_arena_;
+        Arena *arena_ = &own_arena_;
+        Diagnostics own_diagnostics_;
+        Diagnostics *diagnostics_ = &own_diagnostics_;
+        std::size_t first_error_ = 0;
+        // Set by the first error of a statement, silences the cascade until synchronize()
+        bool panic_mode_ = false;
+        // Blocks being parsed, a '}' inside one is left for block() to close it
+        int block_depth_ = 0;
+
+        template <typename T>
+        auto make(T &&node) -> Expr
+        {
+            LOX_INSTRUMENT_COUNT(ast_nodes, 1);
+            return make_box(*arena_, std::forward<T>(node));
+        }
+
+        template <typename T>
+        auto make_stmt(T &&node) -> Stmt
+        {
+            LOX_INSTRUMENT_COUNT(ast_nodes, 1);
+            return make_box(*arena_, std::forward<T>(node));
+        }
 
         [[nodiscard]] auto is_at_end() const -> bool { return peek().get_type() == TokenType::eof_tok; }
 
-        [[nodiscard]] auto peek() const -> const Token & { return tokens_[current_]; }
+        [[nodiscard]] auto peek() const -> const Token & { return scanner_ != nullptr ? *current_token_ : tokens_[current_]; }
 
         auto advance() -> const Token &
         {
             if (!is_at_end())
             {
-                current_++;
+                if (scanner_ != nullptr)
+                {
+                    previous_token_ = std::move(current_token_);
+                    current_token_ = scanner_->next_token();
+                }
+                else
+                {
+                    current_++;
+                }
             }
             return previous();
         }
 
-        [[nodiscard]] auto previous() const -> const Token & { return tokens_[current_ - 1]; }
+        [[nodiscard]] auto previous() const -> const Token & { return scanner_ != nullptr ? *previous_token_ : tokens_[current_ - 1]; }
 
         [[nodiscard]] auto check(TokenType type) const -> bool
         {
@@ -43,15 +117,13 @@ namespace lox
             return peek().get_type() == type;
         }
 
-        auto match(std::vector<TokenType> types) -> bool
+        template <typename... Types>
+        auto match(Types... types) -> bool
         {
-            for (auto type : types)
+            if ((check(types) || ...))
             {
-                if (check(type))
-                {
-                    advance();
-                    return true;
-                }
+                advance();
+                return true;
             }
             return false;
         }
@@ -62,52 +134,106 @@ namespace lox
             {
                 return advance();
             }
-            std::cout << message << " Error" << std::endl;
-            throw LoxException("Expected " + std::string{message});
+            error_at(peek(), DiagnosticCode::expected_token, message);
+            return peek();
+        }
+
+        auto error_at(const Token &token, DiagnosticCode code, std::string_view message) -> void
+        {
+            if (panic_mode_)
+            {
+                return;
+            }
+            panic_mode_ = true;
+            diagnostics_->report(code, token.get_lexeme(), token.get_line(), message);
         }
 
-        auto or_expression() -> Expr;
-        auto and_expression() -> Expr;
-        auto equality() -> Expr;
-        auto comparison() -> Expr;
-        auto term() -> Expr;
-        auto factor() -> Expr;
-        auto unary() -> Expr;
-        auto primary() -> Expr;
         auto expression() -> Expr;
-        auto get_expression() -> Expr;
+        auto parse_precedence(Precedence precedence) -> Expr;
+
+
+        // Prefix handlers, the leading token has been consumed
+        auto grouping() -> Expr;
+        auto unary() -> Expr;
+        auto literal() -> Expr;
+        auto number_or_string() -> Expr;
+        auto variable() -> Expr;
+
+        // Infix handlers, the operator has been consumed
+        auto binary(Expr left) -> Expr;
+        auto logical(Expr left) -> Expr;
+        auto assignment(Expr left) -> Expr;
+        auto call(Expr left) -> Expr;
+        auto get_expression(Expr left) -> Expr;
 
+        auto declaration() -> Stmt;
+        auto var_declaration() -> Stmt;
+        auto class_declaration() -> Stmt;
+        auto statement() -> Stmt;
+        auto print_statement() -> Stmt;
+        auto expression_statement() -> Stmt;
+        auto block() -> Stmt;
+        auto if_statement() -> Stmt;
+        auto while_statement() -> Stmt;
+        auto for_statement() -> Stmt;
+
+        // Skips to a likely statement boundary after an error: past a ';', before a statement keyword
+        // or before the '}' closing the enclosing block
         auto synchronize() -> void
         {
-            advance();
+            panic_mode_ = false;
             while (!is_at_end())
             {
                 if (previous().get_type() == TokenType::semicolon_tok)
                 {
                     return;
                 }
+                switch (peek().get_type())
+                {
+                case TokenType::class_tok:
+                case TokenType::fun_tok:
+                case TokenType::var_tok:
+                case TokenType::for_tok:
+                case TokenType::if_tok:
+                case TokenType::while_tok:
+                case TokenType::print_tok:
+                case TokenType::return_tok:
+                case TokenType::right_brace_tok:
+                    return;
+                default:
+                    break;
+                }
+                advance();
             }
-            switch (peek().get_type())
-            {
-            case TokenType::class_tok:
-            case TokenType::fun_tok:
-            case TokenType::var_tok:
-            case TokenType::while_tok:
-            case TokenType::print_tok:
-            case TokenType::return_tok:
-                return;
-            default:
-                break;
-            }
-            advance();
         }
 
     public:
         Parser(std::span<Token> tokens);
+        // Allocates the tree into a caller owned arena so it can outlive the parser
+        Parser(std::span<Token> tokens, Arena &arena);
+        // Reports into a caller owned sink, pass the scanner's diagnostics() to get located errors
+        Parser(std::span<Token> tokens, Diagnostics &diagnostics);
+        Parser(std::span<Token> tokens, Arena &arena, Diagnostics &diagnostics);
+        // Parses while scanning, the scanner must outlive the parser. Errors go to the scanner's diagnostics()
+        Parser(Scanner &scanner);
+        Parser(Scanner &scanner, Arena &arena);
         Parser() = default;
 
+        Parser(const Parser &) = delete;
+        auto operator=(const Parser &) -> Parser & = delete;
+
         auto parse_expression() -> std::span<Expr>;
+        // Parses a whole program of declarations and statements.
+        // Syntax errors don't stop parsing, they are reported and the program must not be compiled when had_error()
+        auto parse() -> std::span<Stmt>;
+
+        // Errors reported by this parser, a shared sink may also hold the scanner's
+        [[nodiscard]] auto had_error() const -> bool { return diagnostics_->error_count() > first_error_; }
+        [[nodiscard]] auto diagnostics() const -> const Diagnostics & { return *diagnostics_; }
     };
 
+    // Scans and parses a whole program into the arena, or returns every lexical and syntax error
+    [[nodiscard]] auto parse_program(std::string_view source, Arena &arena) -> std::expected<std::span<Stmt>, Diagnostics>;
+
 }
 #endif
\ No newline at end of file
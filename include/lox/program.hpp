@@ -0,0 +1,31 @@
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+#include "lox/chunk.hpp"
+#include "lox/diagnostics.hpp"
+
+#include <expected>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace lox {
+
+// Compiled script that is never modified after it is built. Copies share one Chunk, so a Program can be
+// handed to any number of threads at once, each running it on a VM of its own: everything a run mutates
+// (heap, globals, inline caches, native code) belongs to the VM, the Chunk only holds code and constants.
+class Program {
+private:
+	std::shared_ptr<const Chunk> chunk_;
+
+public:
+	explicit Program(Chunk chunk) : chunk_(std::make_shared<const Chunk>(std::move(chunk))) {}
+
+	[[nodiscard]] auto chunk() const -> const Chunk& { return *chunk_; }
+};
+
+// Scans, parses and compiles a script. Like parse_program every lexical and syntax error is returned,
+// and each call owns its Scanner, Parser and Compiler so threads can compile concurrently
+[[nodiscard]] auto compile_program(std::string_view source) -> std::expected<Program, Diagnostics>;
+
+}  // namespace lox
+#endif
@@ -0,0 +1,67 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+#include "lox/ast.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// Static pass binding every Var, Class, Variable and Assign to its storage before code generation,
+// so the VM indexes stack slots and a global table instead of looking variables up by name.
+// Block scoped variables get the stack slot they will occupy, each distinct top level name gets a global slot.
+// Scoping errors throw LoxException.
+class Resolver {
+private:
+	struct Local {
+		std::string_view name;
+		int depth;  // -1 while the initializer is being resolved
+	};
+
+	std::vector<Local> locals_;
+	std::unordered_map<std::string_view, std::uint16_t> global_slots_;
+	std::vector<std::string_view> globals_;
+	int scope_depth_ = 0;
+
+	auto statement(Stmt& stmt) -> void;
+	auto expression(Expr& expr) -> void;
+
+	auto visit(Expression& stmt) -> void;
+	auto visit(Print& stmt) -> void;
+	auto visit(Var& stmt) -> void;
+	auto visit(Block& stmt) -> void;
+	auto visit(If& stmt) -> void;
+	auto visit(While& stmt) -> void;
+	auto visit(Class& stmt) -> void;
+
+	auto visit(Unary& expr) -> void;
+	auto visit(Binary& expr) -> void;
+	auto visit(Grouping& expr) -> void;
+	auto visit(Literal& expr) -> void;
+	auto visit(Variable& expr) -> void;
+	auto visit(Logical& expr) -> void;
+	auto visit(Get& expr) -> void;
+	auto visit(Set& expr) -> void;
+	auto visit(Call& expr) -> void;
+	auto visit(Assign& expr) -> void;
+
+	auto declare(std::string_view name) -> void;
+	auto define() -> Binding;
+	auto lookup(std::string_view name) -> Binding;
+	auto global(std::string_view name) -> Binding;
+
+public:
+	Resolver() = default;
+
+	auto resolve(std::span<Stmt> program) -> void;
+	auto resolve(Expr& expr) -> void;
+
+	// Names of the global slots handed out so far, indexed by slot
+	[[nodiscard]] auto globals() const -> std::span<const std::string_view> { return globals_; }
+};
+
+}  // namespace lox
+#endif
@@ -0,0 +1,31 @@
+#ifndef SCAN_KERNELS_HPP
+#define SCAN_KERNELS_HPP
+
+namespace lox {
+
+enum class SimdLevel { scalar, sse2, avx2 };
+
+// Byte run primitives used by the Scanner's hot loops.
+// Each returns the first position in [first, last) that ends the run, or last.
+struct ScanKernels {
+	SimdLevel level;
+	// Spaces, tabs, carriage returns and newlines, newlines are added to the counter
+	const char* (*skip_whitespace)(const char* first, const char* last, unsigned int& newlines);
+	// Stops at '\n', used for the end of // comments
+	const char* (*find_newline)(const char* first, const char* last);
+	// Stops at '"', newlines inside the string are added to the counter
+	const char* (*find_quote)(const char* first, const char* last, unsigned int& newlines);
+	// [A-Za-z0-9_]
+	const char* (*span_identifier)(const char* first, const char* last);
+	// [0-9]
+	const char* (*span_digits)(const char* first, const char* last);
+};
+
+// Best kernels the running CPU supports, picked once on first use
+[[nodiscard]] auto scan_kernels() -> const ScanKernels&;
+
+// Kernels for a given level, falls back to the best supported level below it
+[[nodiscard]] auto scan_kernels(SimdLevel level) -> const ScanKernels&;
+
+}  // namespace lox
+#endif
@@ -1,6 +1,10 @@
 #ifndef SCANNER_HPP
 #define SCANNER_HPP
+#include "lox/diagnostics.hpp"
+#include "lox/scan_kernels.hpp"
 #include "lox/tokens.hpp"
+#include <cstddef>
+#include <optional>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -8,28 +12,62 @@ namespace lox {
 class Scanner {
 private:
 	std::string_view source_;
-	std::vector<Token> tokens_;
+	// Token produced by the last scan_token() call, whitespace and comments produce none
+	std::optional<Token> pending_;
+	const ScanKernels* kernels_;
+	Diagnostics diagnostics_;
 
 	unsigned int start_   = 0;
 	unsigned int current_ = 0;
 	unsigned int line_    = 0;
 
+	std::size_t rescanned_chunks_ = 0;
+
 public:
-	Scanner(const std::string_view source) : source_(source) {}
+	Scanner(const std::string_view source, const ScanKernels& kernels = scan_kernels())
+	    : source_(source), kernels_(&kernels), diagnostics_(source) {}
 
+	// Lexical errors are reported to diagnostics() and skipped, scanning always reaches eof_tok
 	auto scan_tokens() -> std::vector<Token>;
 
+	// Pull mode: scans just far enough to produce the next token, keeps returning eof_tok at the end
+	auto next_token() -> Token;
+
+	// Splits the source at line boundaries and scans the pieces on up to `threads` threads.
+	// Produces exactly the tokens of scan_tokens(), small sources are scanned sequentially.
+	auto scan_tokens_parallel(unsigned int threads) -> std::vector<Token>;
+	// Chunks of the last scan_tokens_parallel() whose speculative scan was wrong and redone on the calling thread
+	[[nodiscard]] auto rescanned_chunks() const -> std::size_t { return rescanned_chunks_; }
+
+	[[nodiscard]] auto diagnostics() -> Diagnostics& { return diagnostics_; }
+	[[nodiscard]] auto diagnostics() const -> const Diagnostics& { return diagnostics_; }
+
 private:
+	// Tokens starting in [begin, end) scanned from a given line, the last one may run past end
+	struct RangeResult {
+		std::vector<Token> tokens;
+		unsigned int stop = 0;  // where scanning actually stopped, >= end
+		unsigned int line = 0;  // line at stop
+		bool failed       = false;  // hit a lexical error
+	};
+
+	auto scan_range(unsigned int begin, unsigned int end, unsigned int line) const -> RangeResult;
+
 	auto scan_token() -> void;
 	auto add_token(TokenType type) -> void;
-	auto add_token(TokenType type, LiteralType literal) -> void;
-	auto add_token(TokenType type, std::string_view lexeme, LiteralType literal) -> void;
+	auto error(DiagnosticCode code, std::string_view message) -> void;
 
 	auto advance() -> char const { return source_[current_++]; }
 
 	auto handle_identifier() -> void;
 	auto handle_number() -> void;
 	auto handle_string() -> void;
+	auto skip_whitespace() -> void;
+
+	// Moves current_ to where a kernel stopped scanning
+	auto seek(const char* position) -> void { current_ = static_cast<unsigned int>(position - source_.data()); }
+	auto cursor() const -> const char* { return source_.data() + current_; }
+	auto source_end() const -> const char* { return source_.data() + source_.size(); }
 
 	auto is_at_end() -> bool { return current_ >= source_.size(); }
 
@@ -0,0 +1,43 @@
+#ifndef SOURCE_FILE_HPP
+#define SOURCE_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace lox {
+
+// Read only view of a script file for the Scanner.
+// Regular files are memory mapped so scanning reads the page cache directly,
+// pipes, ttys and other unmappable inputs are read into an owned buffer instead.
+// Tokens point into this storage, keep the SourceFile alive as long as they are used.
+class SourceFile {
+private:
+	const char* data_ = nullptr;
+	std::size_t size_ = 0;
+	bool mapped_      = false;
+	std::string buffer_;
+
+	auto release() -> void;
+
+public:
+	SourceFile() = default;
+	SourceFile(const SourceFile&)                    = delete;
+	auto operator=(const SourceFile&) -> SourceFile& = delete;
+	SourceFile(SourceFile&& other) noexcept;
+	auto operator=(SourceFile&& other) noexcept -> SourceFile&;
+	~SourceFile() { release(); }
+
+	// Throws LoxException when the file can't be opened or read, "-" reads standard input
+	[[nodiscard]] static auto open(const std::filesystem::path& path) -> SourceFile;
+	// Buffered read of an already open descriptor until end of file
+	[[nodiscard]] static auto read(int fd) -> SourceFile;
+
+	[[nodiscard]] auto view() const -> std::string_view { return {data_, size_}; }
+	[[nodiscard]] auto size() const -> std::size_t { return size_; }
+	[[nodiscard]] auto is_mapped() const -> bool { return mapped_; }
+};
+
+}  // namespace lox
+#endif
@@ -1,7 +1,10 @@
 #ifndef TOKENS_HPP
 #define TOKENS_HPP
 
-#include <map>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <variant>
@@ -21,7 +24,7 @@ namespace lox
 
     using LiteralType = std::variant<std::monostate, double, bool, std::string_view>;
     using EvalResult = std::variant<std::monostate, double, bool, std::string>;
-    enum class TokenType
+    enum class TokenType : std::uint8_t
     {
         left_paren_tok,  // 0
         right_paren_tok, // 1
@@ -67,61 +70,68 @@ namespace lox
         eof_tok     // 38
     };
 
-    inline std::map<TokenType, std::string> token_names =
+    // Indexed by TokenType. Read only, like keywords, so any number of threads can scan and print tokens
+    inline constexpr std::array<std::string_view, 39> token_names =
         {
-            {TokenType::left_paren_tok, "left paren"},
-            {TokenType::right_paren_tok, "right paren"},
-            {TokenType::left_brace_tok, "left brace"},
-            {TokenType::right_brace_tok, "right brace"},
-            {TokenType::comma_tok, "comma"},
-            {TokenType::dot_tok, "dot"},
-            {TokenType::minus_tok, "minus"},
-            {TokenType::plus_tok, "plus"},
-            {TokenType::semicolon_tok, "semicolon"},
-            {TokenType::slash_tok, "slash"},
-            {TokenType::star_tok, "star"},
-
-            {TokenType::bang_tok, "bang"},
-            {TokenType::bang_equal_tok, "bang equal"},
-            {TokenType::equal_tok, "equal"},
-            {TokenType::equal_equal_tok, "equal equal"},
-            {TokenType::greater_tok, "greater"},
-            {TokenType::greater_equal_tok, "greater equal"},
-            {TokenType::less_tok, "less"},
-            {TokenType::less_equal_tok, "less equal"},
-
-            {TokenType::identifier_tok, "identifier"},
-            {TokenType::string_tok, "string"},
-            {TokenType::number_tok, "number"},
-
-            {TokenType::and_tok, "and"},
-            {TokenType::class_tok, "class"},
-            {TokenType::else_tok, "else"},
-            {TokenType::false_tok, "false"},
-            {TokenType::fun_tok, "fun"},
-            {TokenType::for_tok, "for"},
-            {TokenType::if_tok, "if"},
-            {TokenType::nil_tok, "nil"},
-            {TokenType::or_tok, "or"},
-            {TokenType::print_tok, "print"},
-            {TokenType::return_tok, "return"},
-            {TokenType::super_tok, "super"},
-            {TokenType::this_tok, "this"},
-            {TokenType::true_tok, "true"},
-            {TokenType::var_tok, "var"},
-            {TokenType::while_tok, "while"},
-            {TokenType::eof_tok, "end of file"}
+            "left paren",
+            "right paren",
+            "left brace",
+            "right brace",
+            "comma",
+            "dot",
+            "minus",
+            "plus",
+            "semicolon",
+            "slash",
+            "star",
 
+            "bang",
+            "bang equal",
+            "equal",
+            "equal equal",
+            "greater",
+            "greater equal",
+            "less",
+            "less equal",
+
+            "identifier",
+            "string",
+            "number",
+
+            "and",
+            "class",
+            "else",
+            "false",
+            "fun",
+            "for",
+            "if",
+            "nil",
+            "or",
+            "print",
+            "return",
+            "super",
+            "this",
+            "true",
+            "var",
+            "while",
+            "end of file"
     };
+    static_assert(token_names.size() == static_cast<std::size_t>(TokenType::eof_tok) + 1, "a name for every TokenType");
 
     template <typename T>
-    auto as_integer(T const value)
+    constexpr auto as_integer(T const value)
         -> typename std::underlying_type<T>::type
     {
         return static_cast<typename std::underlying_type<T>::type>(value);
     }
 
-    inline std::map<std::string_view, TokenType> keywords = {
+    struct Keyword
+    {
+        std::string_view text;
+        TokenType type;
+    };
+
+    inline constexpr std::array<Keyword, 16> keywords = {{
         {"and", TokenType::and_tok},
         {"class", TokenType::class_tok},
         {"else", TokenType::else_tok},
@@ -138,27 +148,126 @@ namespace lox
         {"true", TokenType::true_tok},
         {"var", TokenType::var_tok},
         {"while", TokenType::while_tok},
-    };
+    }};
+
+    namespace detail
+    {
+        // Keywords are classified with a perfect hash over (first char, last char, length)
+        // whose seed is searched at compile time, a lookup is one hash and one compare
+        inline constexpr std::size_t keyword_table_size = 32;
+        inline constexpr std::size_t keyword_min_length = 2;
+        inline constexpr std::size_t keyword_max_length = 6;
+
+        constexpr auto keyword_hash(std::string_view text, std::size_t seed) -> std::size_t
+        {
+            auto first = static_cast<unsigned char>(text.front());
+            auto last = static_cast<unsigned char>(text.back());
+            return (first * seed + last + text.size()) & (keyword_table_size - 1);
+        }
+
+        consteval auto is_perfect(std::size_t seed) -> bool
+        {
+            std::array<bool, keyword_table_size> used{};
+            for (const auto &keyword : keywords)
+            {
+                auto slot = keyword_hash(keyword.text, seed);
+                if (used[slot])
+                {
+                    return false;
+                }
+                used[slot] = true;
+            }
+            return true;
+        }
+
+        consteval auto find_keyword_seed() -> std::size_t
+        {
+            std::size_t seed = 1;
+            while (!is_perfect(seed))
+            {
+                seed++;
+            }
+            return seed;
+        }
+
+        inline constexpr std::size_t keyword_seed = find_keyword_seed();
 
+        // Slot -> index into keywords, -1 for empty slots
+        inline constexpr auto keyword_slots = []
+        {
+            std::array<signed char, keyword_table_size> slots{};
+            slots.fill(-1);
+            for (std::size_t i = 0; i < keywords.size(); i++)
+            {
+                slots[keyword_hash(keywords[i].text, keyword_seed)] = static_cast<signed char>(i);
+            }
+            return slots;
+        }();
+    }
+
+    // Returns the keyword's token type or identifier_tok, never allocates
+    constexpr auto keyword_type(std::string_view text) -> TokenType
+    {
+        if (text.size() < detail::keyword_min_length || text.size() > detail::keyword_max_length)
+        {
+            return TokenType::identifier_tok;
+        }
+        auto slot = detail::keyword_slots[detail::keyword_hash(text, detail::keyword_seed)];
+        if (slot < 0 || keywords[slot].text != text)
+        {
+            return TokenType::identifier_tok;
+        }
+        return keywords[slot].type;
+    }
+
+    static_assert(keyword_type("while") == TokenType::while_tok);
+    static_assert(keyword_type("whale") == TokenType::identifier_tok);
+
+    // Packed into 16 bytes: the lexeme is a pointer/length pair into the source, line and type share
+    // one word and literals are decoded from the lexeme on demand instead of being stored
     class Token
     {
-        TokenType type_;
-        std::string_view lexeme_;
-        LiteralType literal_;
-        unsigned int line_;
+        const char *lexeme_start_;
+        std::uint32_t lexeme_length_;
+        std::uint32_t line_ : 24;
+        std::uint32_t type_ : 8;
 
     public:
-        Token(TokenType type, std::string_view lexeme, LiteralType literal, unsigned int line)
-            : type_(type), lexeme_(lexeme), literal_(literal), line_(line) {}
+        // Lines past this saturate, which only affects error messages for sources over 16M lines
+        static constexpr unsigned int max_line = (1u << 24) - 1;
 
-        [[nodiscard]] auto get_type() const -> const TokenType { return type_; }
+        Token(TokenType type, std::string_view lexeme, unsigned int line)
+            : lexeme_start_(lexeme.data()), lexeme_length_(static_cast<std::uint32_t>(lexeme.size())),
+              line_(line < max_line ? line : max_line), type_(static_cast<std::uint32_t>(type)) {}
 
-        [[nodiscard]] auto get_literal() const -> const LiteralType { return literal_; }
+        [[nodiscard]] auto get_type() const -> const TokenType { return static_cast<TokenType>(type_); }
+
+        [[nodiscard]] auto get_literal() const -> const LiteralType
+        {
+            switch (get_type())
+            {
+            case TokenType::number_tok:
+            {
+                double value = 0;
+                std::from_chars(lexeme_start_, lexeme_start_ + lexeme_length_, value);
+                return value;
+            }
+            case TokenType::string_tok:
+                // Trim the surrounding quotes
+                return get_lexeme().substr(1, lexeme_length_ - 2);
+            default:
+                return std::monostate{};
+            }
+        }
+
+        [[nodiscard]] auto get_lexeme() const -> std::string_view { return {lexeme_start_, lexeme_length_}; }
+
+        [[nodiscard]] auto get_line() const -> unsigned int { return line_; }
 
         [[nodiscard]] auto to_string() const -> std::string
         {
             std::string lit, lexeme;
-            lexeme = lexeme_;
+            lexeme = get_lexeme();
             std::visit(visit_overloader{[&](const int &v)
                                         { lit = std::to_string(v); },
                                         [&](const double &v)
@@ -169,10 +278,12 @@ namespace lox
                                         { lit = "nil"; },
                                         [&](const bool &v)
                                         { lit = std::to_string(v); }},
-                       literal_);
+                       get_literal());
 
-            return "TokenType: " + token_names.at(type_) + ", Lexeme: " + lexeme + ", Literal: " + lit;
+            return "TokenType: " + std::string{token_names.at(as_integer(get_type()))} + ", Lexeme: " + lexeme + ", Literal: " + lit;
         } // namespace mirscript
     };
+
+    static_assert(sizeof(Token) == 16, "Token is meant to stay 16 bytes for cache density");
 } // namespace mirscript
 #endif
\ No newline at end of file
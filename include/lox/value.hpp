@@ -0,0 +1,92 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+#include "lox/object.hpp"
+#include "lox/tokens.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <string>
+
+namespace lox {
+
+// 8 byte NaN boxed runtime value.
+// Doubles are stored as is, everything else hides in the payload of a quiet NaN:
+// nil/false/true use the low tag bits and object pointers additionally set the sign bit.
+class Value {
+private:
+	static constexpr std::uint64_t quiet_nan = 0x7ffc000000000000;
+	static constexpr std::uint64_t sign_bit  = 0x8000000000000000;
+	static constexpr std::uint64_t nil_tag   = 1;
+	static constexpr std::uint64_t false_tag = 2;
+	static constexpr std::uint64_t true_tag  = 3;
+
+	std::uint64_t bits_;
+
+public:
+	constexpr Value() : bits_(quiet_nan | nil_tag) {}
+	constexpr Value(double number) : bits_(std::bit_cast<std::uint64_t>(number)) {}
+	constexpr Value(bool boolean) : bits_(quiet_nan | (boolean ? true_tag : false_tag)) {}
+	Value(Obj* object) : bits_(sign_bit | quiet_nan | reinterpret_cast<std::uintptr_t>(object)) {}
+
+	[[nodiscard]] static constexpr auto nil() -> Value { return Value{}; }
+	// Not a Lox value, marks storage such as a global slot that hasn't been defined yet
+	[[nodiscard]] static constexpr auto empty() -> Value { return from_bits(quiet_nan); }
+
+	[[nodiscard]] static constexpr auto from_bits(std::uint64_t bits) -> Value {
+		Value value;
+		value.bits_ = bits;
+		return value;
+	}
+
+	[[nodiscard]] constexpr auto is_number() const -> bool { return (bits_ & quiet_nan) != quiet_nan; }
+	[[nodiscard]] constexpr auto is_nil() const -> bool { return bits_ == (quiet_nan | nil_tag); }
+	[[nodiscard]] constexpr auto is_empty() const -> bool { return bits_ == quiet_nan; }
+	[[nodiscard]] constexpr auto is_bool() const -> bool { return (bits_ | 1) == (quiet_nan | true_tag); }
+	[[nodiscard]] constexpr auto is_obj() const -> bool { return (bits_ & (quiet_nan | sign_bit)) == (quiet_nan | sign_bit); }
+	[[nodiscard]] auto is_string() const -> bool { return is_obj() && as_obj()->type == ObjType::string_obj; }
+	[[nodiscard]] auto is_class() const -> bool { return is_obj() && as_obj()->type == ObjType::class_obj; }
+	[[nodiscard]] auto is_instance() const -> bool { return is_obj() && as_obj()->type == ObjType::instance_obj; }
+
+	[[nodiscard]] constexpr auto as_number() const -> double { return std::bit_cast<double>(bits_); }
+	[[nodiscard]] constexpr auto as_bool() const -> bool { return bits_ == (quiet_nan | true_tag); }
+	[[nodiscard]] auto as_obj() const -> Obj* { return reinterpret_cast<Obj*>(bits_ & ~(sign_bit | quiet_nan)); }
+	[[nodiscard]] auto as_string() const -> ObjString* { return static_cast<ObjString*>(as_obj()); }
+	[[nodiscard]] auto as_class() const -> ObjClass* { return static_cast<ObjClass*>(as_obj()); }
+	[[nodiscard]] auto as_instance() const -> ObjInstance* { return static_cast<ObjInstance*>(as_obj()); }
+
+	// nil and false are the only falsey values
+	[[nodiscard]] constexpr auto is_falsey() const -> bool { return is_nil() || bits_ == (quiet_nan | false_tag); }
+
+	[[nodiscard]] constexpr auto bits() const -> std::uint64_t { return bits_; }
+
+	// Numbers follow IEEE equality, everything else compares by identity, which for interned strings is by content
+	friend constexpr auto operator==(Value a, Value b) -> bool {
+		if (a.is_number() && b.is_number()) {
+			return a.as_number() == b.as_number();
+		}
+		return a.bits_ == b.bits_;
+	}
+};
+
+static_assert(sizeof(Value) == 8, "Value must stay a single machine word");
+
+// Defined here because it needs Value, inline since it runs on every global store
+inline auto Heap::write_barrier(Value value) -> void {
+	if (phase_ == Phase::marking) {
+		mark(value);
+	}
+}
+
+// Conversions between runtime values and the front end's literal and result types
+[[nodiscard]] auto to_value(const LiteralType& literal, Heap& heap) -> Value;
+[[nodiscard]] auto to_value(const EvalResult& result, Heap& heap) -> Value;
+// The returned string_view points into the value's string object
+[[nodiscard]] auto to_literal(Value value) -> LiteralType;
+// Objects other than strings have no EvalResult counterpart and become their printed form
+[[nodiscard]] auto to_eval_result(Value value) -> EvalResult;
+
+[[nodiscard]] auto stringify(Value value) -> std::string;
+[[nodiscard]] auto stringify(const EvalResult& value) -> std::string;
+
+}  // namespace lox
+#endif
@@ -0,0 +1,75 @@
+#ifndef VM_HPP
+#define VM_HPP
+#include "lox/chunk.hpp"
+#include "lox/inline_cache.hpp"
+#include "lox/jit.hpp"
+#include "lox/object.hpp"
+#include "lox/program.hpp"
+#include "lox/tokens.hpp"
+#include "lox/value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// Stack machine executing a Chunk, globals survive between runs so a VM can be fed chunk after chunk.
+// A VM shares no state with other VMs and is not synchronized: give each thread its own and share Programs
+class VM {
+private:
+	static constexpr std::size_t stack_max = 16 * 1024;
+
+	Heap heap_;
+	std::vector<Value> stack_;
+	// The chunk's constant pool materialized as runtime values for the current run
+	std::vector<Value> constants_;
+	// Keyed by interned name. Nodes never move, so a run links the chunk's global slots to them once
+	// and then reads and writes globals through that table without hashing
+	std::unordered_map<ObjString*, Value> globals_;
+	std::vector<Value*> global_slots_;
+	// One per property access site of the running chunk
+	std::vector<PropertyCache> inline_caches_;
+	IcStats ic_stats_;
+	// One per jit_region_op of the running chunk
+	struct JitRegion {
+		JitCode code;
+		JitFunction entry           = nullptr;
+		std::uint32_t executions     = 0;
+		std::uint32_t guard_failures = 0;
+	};
+	std::vector<JitRegion> jit_regions_;
+	JitConfig jit_config_;
+	JitStats jit_stats_;
+	std::ostream* out_;
+	// End of the live stack as of the last possible collection point, run() keeps its top in a register
+	Value* stack_top_;
+
+	auto mark_roots(Heap& heap) -> void;
+	auto tier_up(JitRegion& region, const std::uint8_t* code, std::size_t length) -> void;
+	auto guard_failed(JitRegion& region) -> void;
+
+public:
+	explicit VM(std::ostream& out = std::cout, GcConfig gc = {}, JitConfig jit = {});
+	VM(const VM&)                    = delete;
+	auto operator=(const VM&) -> VM& = delete;
+
+	[[nodiscard]] auto gc_stats() const -> const GcStats& { return heap_.stats(); }
+	auto collect_garbage() -> void { heap_.collect(); }
+	[[nodiscard]] auto ic_stats() const -> const IcStats& { return ic_stats_; }
+	[[nodiscard]] auto jit_stats() const -> const JitStats& { return jit_stats_; }
+
+	// Returns the value the chunk left with return_op, runtime errors throw LoxException
+	auto run(const Chunk& chunk) -> EvalResult;
+	auto run(const Program& program) -> EvalResult { return run(program.chunk()); }
+	// Forgets every global and collects the heap so the next run starts like on a new VM, without
+	// allocating a new stack. Statistics are kept
+	auto reset() -> void;
+};
+
+}  // namespace lox
+#endif
@@ -0,0 +1,32 @@
+#include "lox/arena.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace lox {
+
+auto Arena::grow(std::size_t size, std::size_t align) -> void {
+	// Oversized requests get a block of their own so the regular block size stays small
+	auto capacity = std::max(block_size_, size + align);
+	blocks_.push_back(std::make_unique_for_overwrite<std::byte[]>(capacity));
+	cursor_ = blocks_.back().get();
+	limit_  = cursor_ + capacity;
+
+	void* aligned = cursor_;
+	std::align(align, size, aligned, capacity);
+	cursor_ = static_cast<std::byte*>(aligned);
+}
+
+auto Arena::reset() -> void {
+	if (blocks_.size() > 1) {
+		blocks_.erase(blocks_.begin() + 1, blocks_.end());
+	}
+	cursor_ = blocks_.empty() ? nullptr : blocks_.front().get();
+	limit_  = blocks_.empty() ? nullptr : cursor_ + block_size_;
+
+	bytes_allocated_ = 0;
+	allocations_     = 0;
+}
+
+}  // namespace lox
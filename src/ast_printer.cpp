@@ -1,17 +1,66 @@
 #include "lox/ast_printer.hpp"
-class ASTPrinter
-{
-private:
-    /* data */
-public:
-    ASTPrinter(/* args */);
-    ~ASTPrinter();
-};
-
-ASTPrinter::ASTPrinter(/* args */)
-{
-}
 
-ASTPrinter::~ASTPrinter()
+#include <iostream>
+#include <variant>
+
+#include <lox/ast.hpp>
+
+namespace lox
 {
+    void ASTPrinter::print(const Expr &expr)
+    {
+        std::visit([this](const auto &node)
+                   { (*this)(*node); },
+                   expr);
+    }
+
+    void ASTPrinter::operator()(const Unary &unary)
+    {
+        std::cout << "Got unary" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Binary &binary)
+    {
+        std::cout << "Got Binary" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Grouping &grouping)
+    {
+        std::cout << "Got Grouping" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Literal &literal)
+    {
+        std::cout << "Got Literal" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Variable &variable)
+    {
+        std::cout << "Got Variable" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Logical &logical)
+    {
+        std::cout << "Got Logical" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Get &get)
+    {
+        std::cout << "Got Get" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Set &set)
+    {
+        std::cout << "Got Set" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Call &call)
+    {
+        std::cout << "Got Call" << std::endl;
+    }
+
+    void ASTPrinter::operator()(const Assign &assign)
+    {
+        std::cout << "Got Assign" << std::endl;
+    }
 }
@@ -0,0 +1,419 @@
+#include "lox/chunk_cache.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <unistd.h>
+
+#include <lox/arena.hpp>
+#include <lox/compiler.hpp>
+#include <lox/instrument.hpp>
+#include <lox/lox.hpp>
+#include <lox/parser.hpp>
+#include <lox/source_file.hpp>
+
+namespace lox {
+
+namespace {
+
+// Bumped whenever the layout below or the meaning of an opcode changes
+constexpr std::uint32_t format_version = 2;
+
+constexpr std::uint32_t magic = 0x43584f4c;  // "LOXC" read as a little endian word
+
+enum class ConstantTag : std::uint8_t { nil, number, boolean, string };
+
+struct Header {
+	std::uint32_t magic;
+	std::uint32_t version;
+	// Opcodes are numbered by their position in OpCode, an entry from a build with other opcodes is unusable
+	std::uint32_t opcode_count;
+	std::uint32_t code_size;
+	std::uint64_t source_hash;
+	std::uint64_t source_size;
+	std::uint32_t constant_count;
+	std::uint32_t global_count;
+	std::uint32_t string_bytes;
+	std::uint16_t inline_caches;
+	std::uint16_t jit_regions;
+};
+
+// Numbers keep their bits, booleans are 0 or 1, strings are an offset into the pool
+struct Constant {
+	ConstantTag tag;
+	std::uint8_t padding[3];
+	std::uint32_t length;
+	std::uint64_t payload;
+};
+
+static_assert(sizeof(Header) == 48 && sizeof(Constant) == 16, "the image layout is part of the format");
+
+// Images are written in the host byte order and read as little endian, on other hosts every load misses
+// and nothing is stored
+constexpr bool host_supported = std::endian::native == std::endian::little;
+
+constexpr auto align8(std::size_t size) -> std::size_t { return (size + 7) & ~std::size_t{7}; }
+
+// Offsets of each section behind the header, every section starts 8 byte aligned
+struct Layout {
+	std::size_t code;
+	std::size_t lines;
+	std::size_t globals;
+	std::size_t constants;
+	std::size_t strings;
+	std::size_t end;
+
+	explicit Layout(const Header& header) {
+		code      = sizeof(Header);
+		lines     = code + align8(header.code_size);
+		globals   = lines + align8(std::size_t{header.code_size} * sizeof(std::uint32_t));
+		constants = globals + align8(std::size_t{header.global_count} * sizeof(std::uint16_t));
+		strings   = constants + std::size_t{header.constant_count} * sizeof(Constant);
+		end       = strings + header.string_bytes;
+	}
+};
+
+template <typename T>
+auto read(std::span<const char> image, std::size_t offset) -> T {
+	T value;
+	std::memcpy(&value, image.data() + offset, sizeof(T));
+	return value;
+}
+
+auto entry_path(const std::filesystem::path& directory, std::uint64_t hash) -> std::filesystem::path {
+	constexpr const char* digits = "0123456789abcdef";
+	std::string name(16, '0');
+	for (int i = 15; i >= 0; i--, hash >>= 4) {
+		name[static_cast<std::size_t>(i)] = digits[hash & 0xf];
+	}
+	return directory / (name + ".loxc");
+}
+
+}  // namespace
+
+// MurmurHash64A
+auto content_hash(std::string_view source) -> std::uint64_t {
+	constexpr std::uint64_t m = 0xc6a4a7935bd1e995;
+	constexpr int r           = 47;
+
+	std::uint64_t hash = 0x9e3779b97f4a7c15 ^ (source.size() * m);
+	const char* data   = source.data();
+	const char* end    = data + (source.size() & ~std::size_t{7});
+	for (; data != end; data += 8) {
+		std::uint64_t k;
+		std::memcpy(&k, data, 8);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		hash ^= k;
+		hash *= m;
+	}
+	if (auto rest = source.size() & 7; rest != 0) {
+		std::uint64_t k = 0;
+		std::memcpy(&k, data, rest);
+		hash ^= k;
+		hash *= m;
+	}
+	hash ^= hash >> r;
+	hash *= m;
+	hash ^= hash >> r;
+	return hash;
+}
+
+auto serialize(const Chunk& chunk, std::string_view source) -> std::string {
+	std::string strings;
+	std::vector<Constant> constants;
+	constants.reserve(chunk.constants.size());
+	for (const auto& value : chunk.constants) {
+		Constant constant{};
+		std::visit(visit_overloader{[&](std::monostate) { constant.tag = ConstantTag::nil; },
+		                            [&](double number) {
+			                            constant.tag     = ConstantTag::number;
+			                            constant.payload = std::bit_cast<std::uint64_t>(number);
+		                            },
+		                            [&](bool boolean) {
+			                            constant.tag     = ConstantTag::boolean;
+			                            constant.payload = boolean ? 1 : 0;
+		                            },
+		                            [&](const std::string& text) {
+			                            constant.tag     = ConstantTag::string;
+			                            constant.length  = static_cast<std::uint32_t>(text.size());
+			                            constant.payload = strings.size();
+			                            strings += text;
+		                            }},
+		           value);
+		constants.push_back(constant);
+	}
+
+	Header header{
+	    .magic          = magic,
+	    .version        = format_version,
+	    .opcode_count   = static_cast<std::uint32_t>(opcode_count),
+	    .code_size      = static_cast<std::uint32_t>(chunk.code.size()),
+	    .source_hash    = content_hash(source),
+	    .source_size    = source.size(),
+	    .constant_count = static_cast<std::uint32_t>(constants.size()),
+	    .global_count   = static_cast<std::uint32_t>(chunk.globals.size()),
+	    .string_bytes   = static_cast<std::uint32_t>(strings.size()),
+	    .inline_caches  = chunk.inline_caches,
+	    .jit_regions    = chunk.jit_regions,
+	};
+	Layout layout{header};
+
+	std::string image(layout.end, '\0');
+	auto write = [&](std::size_t offset, const void* data, std::size_t size) {
+		if (size != 0) {
+			std::memcpy(image.data() + offset, data, size);
+		}
+	};
+	write(0, &header, sizeof header);
+	write(layout.code, chunk.code.data(), chunk.code.size());
+	static_assert(sizeof(unsigned int) == sizeof(std::uint32_t));
+	write(layout.lines, chunk.lines.data(), chunk.lines.size() * sizeof(std::uint32_t));
+	write(layout.globals, chunk.globals.data(), chunk.globals.size() * sizeof(std::uint16_t));
+	write(layout.constants, constants.data(), constants.size() * sizeof(Constant));
+	write(layout.strings, strings.data(), strings.size());
+	return image;
+}
+
+namespace {
+
+// Stores started by this process, names their temporary files
+std::atomic<std::uint64_t> temporary_count{0};
+
+// Whether every operand and global slot of a decoded chunk stays inside the tables and code it refers to.
+// A damaged entry whose header still matches is rejected here instead of indexing out of bounds in the VM.
+// Local slots and stack depths are not checked
+auto references_valid(const Chunk& chunk) -> bool {
+	auto is_string = [&](std::size_t index) {
+		return index < chunk.constants.size() && std::holds_alternative<std::string>(chunk.constants[index]);
+	};
+	for (auto name : chunk.globals) {
+		if (!is_string(name)) {
+			return false;
+		}
+	}
+
+	const auto& code = chunk.code;
+	auto u16         = [&](std::size_t at) -> std::size_t { return code[at] << 8 | code[at + 1]; };
+	// Jumps may only land on the start of an instruction
+	std::vector<std::uint8_t> starts(code.size());
+	std::vector<std::size_t> targets;
+	std::size_t pc   = 0;
+	std::size_t last = 0;
+	while (pc < code.size()) {
+		if (code[pc] >= opcode_count) {
+			return false;
+		}
+		auto op   = static_cast<OpCode>(code[pc]);
+		auto next = pc + 1 + operand_size(op);
+		if (next > code.size()) {
+			return false;
+		}
+		starts[pc] = true;
+		last       = pc;
+		switch (op) {
+			case OpCode::constant_op:
+			case OpCode::add_constant_op:
+			case OpCode::equal_constant_op:
+			case OpCode::greater_constant_op:
+			case OpCode::less_constant_op:
+				if (u16(pc + 1) >= chunk.constants.size()) {
+					return false;
+				}
+				break;
+			case OpCode::get_global_op:
+			case OpCode::define_global_op:
+			case OpCode::set_global_op:
+				if (u16(pc + 1) >= chunk.globals.size()) {
+					return false;
+				}
+				break;
+			case OpCode::get_property_op:
+			case OpCode::set_property_op:
+				if (!is_string(u16(pc + 1)) || u16(pc + 3) >= chunk.inline_caches) {
+					return false;
+				}
+				break;
+			case OpCode::class_op:
+				if (!is_string(u16(pc + 1))) {
+					return false;
+				}
+				break;
+			case OpCode::jump_op:
+			case OpCode::jump_if_false_op:
+			case OpCode::pop_jump_if_false_op:
+				targets.push_back(next + u16(pc + 1));
+				break;
+			case OpCode::loop_op:
+				if (u16(pc + 1) > next) {
+					return false;
+				}
+				targets.push_back(next - u16(pc + 1));
+				break;
+			case OpCode::jit_region_op:
+				if (u16(pc + 1) >= chunk.jit_regions) {
+					return false;
+				}
+				targets.push_back(next + u16(pc + 3));
+				break;
+			default:
+				break;
+		}
+		pc = next;
+	}
+	// The VM stops at return_op only, code must not run off its end
+	if (code.empty() || code[last] != static_cast<std::uint8_t>(OpCode::return_op)) {
+		return false;
+	}
+	for (auto target : targets) {
+		if (target >= code.size() || !starts[target]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Takes the source's size and hash so a load hashes the source only once
+auto decode(std::span<const char> image, std::uint64_t source_size, std::uint64_t source_hash)
+    -> std::optional<Chunk> {
+	if (!host_supported || image.size() < sizeof(Header)) {
+		return std::nullopt;
+	}
+	auto header = read<Header>(image, 0);
+	if (header.magic != magic || header.version != format_version || header.opcode_count != opcode_count ||
+	    header.source_size != source_size || header.source_hash != source_hash) {
+		return std::nullopt;
+	}
+	Layout layout{header};
+	if (layout.end != image.size()) {
+		return std::nullopt;
+	}
+
+	Chunk chunk;
+	chunk.inline_caches = header.inline_caches;
+	chunk.jit_regions   = header.jit_regions;
+	chunk.code.resize(header.code_size);
+	std::memcpy(chunk.code.data(), image.data() + layout.code, header.code_size);
+	chunk.lines.resize(header.code_size);
+	std::memcpy(chunk.lines.data(), image.data() + layout.lines, header.code_size * sizeof(std::uint32_t));
+	chunk.globals.resize(header.global_count);
+	std::memcpy(chunk.globals.data(), image.data() + layout.globals, header.global_count * sizeof(std::uint16_t));
+
+	chunk.constants.reserve(header.constant_count);
+	for (std::uint32_t i = 0; i < header.constant_count; i++) {
+		auto constant = read<Constant>(image, layout.constants + i * sizeof(Constant));
+		switch (constant.tag) {
+		case ConstantTag::nil:
+			chunk.constants.emplace_back(std::monostate{});
+			break;
+		case ConstantTag::number:
+			chunk.constants.emplace_back(std::bit_cast<double>(constant.payload));
+			break;
+		case ConstantTag::boolean:
+			chunk.constants.emplace_back(constant.payload != 0);
+			break;
+		case ConstantTag::string:
+			if (constant.payload > header.string_bytes || constant.length > header.string_bytes - constant.payload) {
+				return std::nullopt;
+			}
+			chunk.constants.emplace_back(std::string{image.data() + layout.strings + constant.payload, constant.length});
+			break;
+		default:
+			return std::nullopt;
+		}
+	}
+	if (!references_valid(chunk)) {
+		return std::nullopt;
+	}
+	return chunk;
+}
+
+}  // namespace
+
+auto deserialize(std::span<const char> image, std::string_view source) -> std::optional<Chunk> {
+	return decode(image, source.size(), content_hash(source));
+}
+
+ChunkCache::ChunkCache(std::filesystem::path directory) : directory_(std::move(directory)) {
+	std::error_code error;
+	std::filesystem::create_directories(directory_, error);
+}
+
+auto ChunkCache::path_for(std::string_view source) const -> std::filesystem::path {
+	return entry_path(directory_, content_hash(source));
+}
+
+auto ChunkCache::load(std::string_view source) const -> std::optional<Chunk> {
+	LOX_INSTRUMENT_SCOPE("cache", "load");
+	auto hash = content_hash(source);
+	auto path = entry_path(directory_, hash);
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(path, error)) {
+		return std::nullopt;
+	}
+	try {
+		auto file = SourceFile::open(path);
+		return decode(file.view(), source.size(), hash);
+	} catch (LoxException&) {
+		return std::nullopt;
+	}
+}
+
+auto ChunkCache::store(std::string_view source, const Chunk& chunk) const -> bool {
+	LOX_INSTRUMENT_SCOPE("cache", "store");
+	if (!host_supported) {
+		return false;
+	}
+	auto path      = path_for(source);
+	// Unique per process and store, threads sharing a script never write the same temporary file
+	auto temporary = path;
+	temporary += ".";
+	temporary += std::to_string(::getpid());
+	temporary += ".";
+	temporary += std::to_string(temporary_count.fetch_add(1, std::memory_order_relaxed));
+	temporary += ".tmp";
+	{
+		auto image = serialize(chunk, source);
+		std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+		out.write(image.data(), static_cast<std::streamsize>(image.size()));
+		out.close();
+		if (!out) {
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+auto ChunkCache::compile(std::string_view source) const -> std::expected<Chunk, Diagnostics> {
+	if (auto cached = load(source)) {
+		return std::move(*cached);
+	}
+	Arena arena;
+	auto program = parse_program(source, arena);
+	if (!program) {
+		return std::unexpected(std::move(program.error()));
+	}
+	auto chunk = Compiler{}.compile(*program);
+	store(source, chunk);
+	return chunk;
+}
+
+}  // namespace lox
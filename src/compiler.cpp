@@ -0,0 +1,470 @@
+#include "lox/compiler.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include <lox/ast.hpp>
+#include <lox/chunk.hpp>
+#include <lox/instrument.hpp>
+#include <lox/lox.hpp>
+#include <lox/resolver.hpp>
+#include <lox/tokens.hpp>
+
+namespace lox {
+
+namespace {
+
+#ifdef LOX_JIT
+// Larger trees are split into regions for their subtrees, which also bounds the cost of this check
+constexpr int max_region_nodes = 128;
+
+// Operators in a tree of number and boolean literals, variables and arithmetic, comparison and logical
+// operators, the expressions the JIT can run without side effects. -1 for any other tree
+auto region_operators(const Expr& expr, int& nodes) -> int {
+	if (++nodes > max_region_nodes) {
+		return -1;
+	}
+	auto both = [&](const Expr& left, const Expr& right) {
+		auto l = region_operators(left, nodes);
+		auto r = l < 0 ? -1 : region_operators(right, nodes);
+		return r < 0 ? -1 : l + r + 1;
+	};
+	return std::visit(
+	    visit_overloader{[&](const Box<Binary>& node) { return both(node->left, node->right); },
+	                     [&](const Box<Logical>& node) { return both(node->left, node->right); },
+	                     [&](const Box<Unary>& node) {
+		                     auto operators = region_operators(node->right, nodes);
+		                     return operators < 0 ? -1 : operators + 1;
+	                     },
+	                     [&](const Box<Grouping>& node) { return region_operators(node->expression, nodes); },
+	                     [](const Box<Literal>& node) {
+		                     return std::holds_alternative<double>(node->value) ||
+		                                    std::holds_alternative<bool>(node->value)
+		                                ? 0
+		                                : -1;
+	                     },
+	                     [](const Box<Variable>&) { return 0; }, [](const auto&) { return -1; }},
+	    expr);
+}
+#endif
+
+}  // namespace
+
+auto Compiler::compile(std::span<Stmt> program) -> Chunk {
+	LOX_INSTRUMENT_SCOPE("compiler", "compile");
+	Resolver resolver;
+	resolver.resolve(program);
+	link_globals(resolver.globals());
+
+	for (std::size_t i = 0; i < program.size(); i++) {
+		const auto* last = std::get_if<Box<Expression>>(&program[i]);
+		if (i + 1 == program.size() && last != nullptr) {
+			expression((*last)->expression);
+			emit(OpCode::return_op);
+			return std::move(chunk_);
+		}
+		statement(program[i]);
+	}
+	emit(OpCode::nil_op);
+	emit(OpCode::return_op);
+	return std::move(chunk_);
+}
+
+auto Compiler::compile(Expr& expr) -> Chunk {
+	LOX_INSTRUMENT_SCOPE("compiler", "compile");
+	Resolver resolver;
+	resolver.resolve(expr);
+	link_globals(resolver.globals());
+
+	expression(expr);
+	emit(OpCode::return_op);
+	return std::move(chunk_);
+}
+
+auto Compiler::statement(const Stmt& stmt) -> void {
+	std::visit([this](const auto& node) { visit(*node); }, stmt);
+}
+
+auto Compiler::expression(const Expr& expr) -> void {
+#ifdef LOX_JIT
+	// A single operator gains less from native code than the region costs the interpreter
+	int nodes = 0;
+	if (jit_regions_ && !in_jit_region_ && chunk_.jit_regions < std::numeric_limits<std::uint16_t>::max() &&
+	    region_operators(expr, nodes) >= 2) {
+		jit_region(expr);
+		return;
+	}
+#endif
+	std::visit([this](const auto& node) { visit(*node); }, expr);
+}
+
+// jit_region_op, then the expression's code as usual so the VM can interpret it until it is hot
+auto Compiler::jit_region(const Expr& expr) -> void {
+	emit_u16(OpCode::jit_region_op, chunk_.jit_regions++);
+	auto length = chunk_.code.size();
+	chunk_.write(0, line_);
+	chunk_.write(0, line_);
+	// Nothing is fused across the region's bounds
+	jump_target_ = chunk_.code.size();
+
+	in_jit_region_ = true;
+	std::visit([this](const auto& node) { visit(*node); }, expr);
+	in_jit_region_ = false;
+
+	auto size = chunk_.code.size() - length - 2;
+	if (size > std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Expression too large.");
+	}
+	chunk_.code[length]     = static_cast<std::uint8_t>((size >> 8) & 0xff);
+	chunk_.code[length + 1] = static_cast<std::uint8_t>(size & 0xff);
+	jump_target_            = chunk_.code.size();
+}
+
+auto Compiler::visit(const Expression& stmt) -> void {
+	expression(stmt.expression);
+	emit(OpCode::pop_op);
+}
+
+auto Compiler::visit(const Print& stmt) -> void {
+	expression(stmt.expression);
+	emit(OpCode::print_op);
+}
+
+auto Compiler::visit(const Var& stmt) -> void {
+	line_ = stmt.token.get_line();
+	expression(stmt.initializer);
+	if (stmt.binding.kind == Binding::Kind::global) {
+		emit_u16(OpCode::define_global_op, stmt.binding.slot);
+		return;
+	}
+	// The initializer result stays on the stack and becomes the local's slot
+	local_depths_.push_back(scope_depth_);
+}
+
+auto Compiler::visit(const Block& stmt) -> void {
+	begin_scope();
+	for (const auto& inner : stmt.statements) {
+		statement(inner);
+	}
+	end_scope();
+}
+
+auto Compiler::visit(const If& stmt) -> void {
+	expression(stmt.condition);
+#ifdef LOX_SUPERINSTRUCTIONS
+	auto then_jump = emit_jump(OpCode::pop_jump_if_false_op);
+	statement(stmt.then_branch);
+	if (!stmt.else_branch) {
+		patch_jump(then_jump);
+		return;
+	}
+	auto else_jump = emit_jump(OpCode::jump_op);
+	patch_jump(then_jump);
+	statement(*stmt.else_branch);
+	patch_jump(else_jump);
+#else
+	auto then_jump = emit_jump(OpCode::jump_if_false_op);
+	emit(OpCode::pop_op);
+	statement(stmt.then_branch);
+	auto else_jump = emit_jump(OpCode::jump_op);
+	patch_jump(then_jump);
+	emit(OpCode::pop_op);
+	if (stmt.else_branch) {
+		statement(*stmt.else_branch);
+	}
+	patch_jump(else_jump);
+#endif
+}
+
+auto Compiler::visit(const While& stmt) -> void {
+	auto start = mark_loop_start();
+	expression(stmt.condition);
+#ifdef LOX_SUPERINSTRUCTIONS
+	auto exit_jump = emit_jump(OpCode::pop_jump_if_false_op);
+	statement(stmt.body);
+	emit_loop(start);
+	patch_jump(exit_jump);
+#else
+	auto exit_jump = emit_jump(OpCode::jump_if_false_op);
+	emit(OpCode::pop_op);
+	statement(stmt.body);
+	emit_loop(start);
+	patch_jump(exit_jump);
+	emit(OpCode::pop_op);
+#endif
+}
+
+auto Compiler::visit(const Class& stmt) -> void {
+	line_ = stmt.name.get_line();
+	emit_u16(OpCode::class_op, string_constant(stmt.name.get_lexeme()));
+	if (stmt.binding.kind == Binding::Kind::global) {
+		emit_u16(OpCode::define_global_op, stmt.binding.slot);
+		return;
+	}
+	local_depths_.push_back(scope_depth_);
+}
+
+auto Compiler::visit(const Unary& expr) -> void {
+	expression(expr.right);
+	line_ = expr.op.get_line();
+	switch (expr.op.get_type()) {
+		case TokenType::minus_tok:
+			emit(OpCode::negate_op);
+			break;
+		case TokenType::bang_tok:
+			emit(OpCode::not_op);
+			break;
+		default:
+			throw LoxException("Unknown unary operator " + std::string{expr.op.get_lexeme()});
+	}
+}
+
+auto Compiler::visit(const Binary& expr) -> void {
+	expression(expr.left);
+	expression(expr.right);
+	line_ = expr.op.get_line();
+	switch (expr.op.get_type()) {
+		case TokenType::plus_tok:
+			emit_fused(OpCode::add_op);
+			break;
+		case TokenType::minus_tok:
+			emit(OpCode::subtract_op);
+			break;
+		case TokenType::star_tok:
+			emit(OpCode::multiply_op);
+			break;
+		case TokenType::slash_tok:
+			emit(OpCode::divide_op);
+			break;
+		case TokenType::equal_equal_tok:
+			emit_fused(OpCode::equal_op);
+			break;
+		case TokenType::bang_equal_tok:
+			emit_fused(OpCode::equal_op);
+			emit(OpCode::not_op);
+			break;
+		case TokenType::greater_tok:
+			emit_fused(OpCode::greater_op);
+			break;
+		case TokenType::greater_equal_tok:
+			emit_fused(OpCode::less_op);
+			emit(OpCode::not_op);
+			break;
+		case TokenType::less_tok:
+			emit_fused(OpCode::less_op);
+			break;
+		case TokenType::less_equal_tok:
+			emit_fused(OpCode::greater_op);
+			emit(OpCode::not_op);
+			break;
+		default:
+			throw LoxException("Unknown binary operator " + std::string{expr.op.get_lexeme()});
+	}
+}
+
+auto Compiler::visit(const Grouping& expr) -> void { expression(expr.expression); }
+
+auto Compiler::visit(const Literal& expr) -> void {
+	std::visit(visit_overloader{[this](std::monostate) { emit(OpCode::nil_op); },
+	                            [this](bool value) { emit(value ? OpCode::true_op : OpCode::false_op); },
+	                            [this](double value) { emit_constant(value); },
+	                            [this](std::string_view value) { emit_u16(OpCode::constant_op, string_constant(value)); }},
+	           expr.value);
+}
+
+auto Compiler::visit(const Variable& expr) -> void {
+	line_ = expr.token.get_line();
+	if (expr.binding.kind == Binding::Kind::local) {
+		emit(OpCode::get_local_op, static_cast<std::uint8_t>(expr.binding.slot));
+	} else {
+		emit_u16(OpCode::get_global_op, expr.binding.slot);
+	}
+}
+
+auto Compiler::visit(const Logical& expr) -> void {
+	expression(expr.left);
+	line_ = expr.op.get_line();
+	if (expr.op.get_type() == TokenType::and_tok) {
+		auto end_jump = emit_jump(OpCode::jump_if_false_op);
+		emit(OpCode::pop_op);
+		expression(expr.right);
+		patch_jump(end_jump);
+		return;
+	}
+
+	auto else_jump = emit_jump(OpCode::jump_if_false_op);
+	auto end_jump  = emit_jump(OpCode::jump_op);
+	patch_jump(else_jump);
+	emit(OpCode::pop_op);
+	expression(expr.right);
+	patch_jump(end_jump);
+}
+
+auto Compiler::visit(const Get& expr) -> void {
+	expression(expr.object);
+	emit_property(OpCode::get_property_op, expr.name);
+}
+
+auto Compiler::visit(const Set& expr) -> void {
+	expression(expr.object);
+	expression(expr.value);
+	emit_property(OpCode::set_property_op, expr.name);
+}
+
+auto Compiler::visit(const Call& expr) -> void {
+	expression(expr.callee);
+	for (const auto& argument : expr.arguments) {
+		expression(argument);
+	}
+	line_ = expr.paren.get_line();
+	emit(OpCode::call_op, static_cast<std::uint8_t>(expr.arguments.size()));
+}
+
+auto Compiler::visit(const Assign& expr) -> void {
+	expression(expr.value);
+	line_ = expr.name.get_line();
+	if (expr.binding.kind == Binding::Kind::local) {
+		emit(OpCode::set_local_op, static_cast<std::uint8_t>(expr.binding.slot));
+	} else {
+		emit_u16(OpCode::set_global_op, expr.binding.slot);
+	}
+}
+
+auto Compiler::emit(OpCode op, std::uint8_t operand) -> void {
+	emit(op);
+	chunk_.write(operand, line_);
+}
+
+auto Compiler::emit_u16(OpCode op, std::size_t operand) -> void {
+	emit(op);
+	chunk_.write(static_cast<std::uint8_t>((operand >> 8) & 0xff), line_);
+	chunk_.write(static_cast<std::uint8_t>(operand & 0xff), line_);
+}
+
+auto Compiler::emit_constant(EvalResult value) -> void {
+	auto index = chunk_.add_constant(std::move(value));
+	if (index > std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Too many constants in one chunk.");
+	}
+	emit_u16(OpCode::constant_op, index);
+}
+
+auto Compiler::emit_jump(OpCode op) -> std::size_t {
+	emit_u16(op, 0xffff);
+	return chunk_.code.size() - 2;
+}
+
+auto Compiler::patch_jump(std::size_t operand) -> void {
+	// -2 to skip over the jump offset itself
+	jump_target_ = chunk_.code.size();
+	auto jump    = chunk_.code.size() - operand - 2;
+	if (jump > std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Too much code to jump over.");
+	}
+	chunk_.code[operand]     = static_cast<std::uint8_t>((jump >> 8) & 0xff);
+	chunk_.code[operand + 1] = static_cast<std::uint8_t>(jump & 0xff);
+}
+
+auto Compiler::emit_loop(std::size_t loop_start) -> void {
+	// +3 to also jump back over the loop instruction and its operand
+	auto offset = chunk_.code.size() - loop_start + 3;
+	if (offset > std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Loop body too large.");
+	}
+	emit_u16(OpCode::loop_op, offset);
+}
+
+auto Compiler::mark_loop_start() -> std::size_t {
+	jump_target_ = chunk_.code.size();
+	return jump_target_;
+}
+
+// Turns the last instruction into fused when it is previous, fused takes the same operand.
+// Whatever the operand computing expression emitted before it leaves the stack as it found it,
+// unless a jump lands in between, so the fused instruction sees the same stack
+auto Compiler::fuse([[maybe_unused]] OpCode previous, [[maybe_unused]] OpCode fused) -> bool {
+#ifdef LOX_SUPERINSTRUCTIONS
+	if (chunk_.code.empty() || last_instruction_ < jump_target_ ||
+	    chunk_.code[last_instruction_] != static_cast<std::uint8_t>(previous)) {
+		return false;
+	}
+	chunk_.code[last_instruction_]  = static_cast<std::uint8_t>(fused);
+	chunk_.lines[last_instruction_] = line_;
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Emits op, or folds it into the instruction pushing its right operand
+auto Compiler::emit_fused(OpCode op) -> void {
+	switch (op) {
+		case OpCode::add_op:
+			if (fuse(OpCode::get_local_op, OpCode::add_local_op) || fuse(OpCode::constant_op, OpCode::add_constant_op)) {
+				return;
+			}
+			break;
+		case OpCode::equal_op:
+			if (fuse(OpCode::constant_op, OpCode::equal_constant_op)) {
+				return;
+			}
+			break;
+		case OpCode::greater_op:
+			if (fuse(OpCode::constant_op, OpCode::greater_constant_op)) {
+				return;
+			}
+			break;
+		case OpCode::less_op:
+			if (fuse(OpCode::constant_op, OpCode::less_constant_op)) {
+				return;
+			}
+			break;
+		default:
+			break;
+	}
+	emit(op);
+}
+
+// Every access site gets an inline cache of its own
+auto Compiler::emit_property(OpCode op, const Token& name) -> void {
+	line_ = name.get_line();
+	if (chunk_.inline_caches == std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Too many property accesses in one chunk.");
+	}
+	emit_u16(op, string_constant(name.get_lexeme()));
+	chunk_.write(static_cast<std::uint8_t>((chunk_.inline_caches >> 8) & 0xff), line_);
+	chunk_.write(static_cast<std::uint8_t>(chunk_.inline_caches & 0xff), line_);
+	chunk_.inline_caches++;
+}
+
+auto Compiler::string_constant(std::string_view text) -> std::uint16_t {
+	if (auto it = strings_.find(text); it != strings_.end()) {
+		return it->second;
+	}
+	auto index = chunk_.add_constant(std::string{text});
+	if (index > std::numeric_limits<std::uint16_t>::max()) {
+		throw LoxException("Too many constants in one chunk.");
+	}
+	strings_.emplace(text, static_cast<std::uint16_t>(index));
+	return static_cast<std::uint16_t>(index);
+}
+
+// The chunk records each global slot's name so the VM can link it to its own globals
+auto Compiler::link_globals(std::span<const std::string_view> names) -> void {
+	for (auto name : names) {
+		chunk_.globals.push_back(string_constant(name));
+	}
+}
+
+auto Compiler::end_scope() -> void {
+	scope_depth_--;
+	while (!local_depths_.empty() && local_depths_.back() > scope_depth_) {
+		emit(OpCode::pop_op);
+		local_depths_.pop_back();
+	}
+}
+
+}  // namespace lox
@@ -0,0 +1,217 @@
+#include "lox/constant_folder.hpp"
+
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+#include <lox/ast.hpp>
+#include <lox/tokens.hpp>
+
+namespace lox {
+
+namespace {
+
+auto literal_value(const Expr& expr) -> const LiteralType* {
+	const auto* literal = std::get_if<Box<Literal>>(&expr);
+	return literal != nullptr ? &(*literal)->value : nullptr;
+}
+
+// Same rule as Value::is_falsey
+auto is_falsey(const LiteralType& value) -> bool {
+	return std::holds_alternative<std::monostate>(value) || (std::holds_alternative<bool>(value) && !std::get<bool>(value));
+}
+
+// The value the VM computes for a comparison or arithmetic on two numbers
+auto number_operation(TokenType op, double a, double b) -> std::optional<LiteralType> {
+	switch (op) {
+		case TokenType::plus_tok:
+			return a + b;
+		case TokenType::minus_tok:
+			return a - b;
+		case TokenType::star_tok:
+			return a * b;
+		case TokenType::slash_tok:
+			return a / b;
+		case TokenType::greater_tok:
+			return a > b;
+		case TokenType::greater_equal_tok:
+			return !(a < b);
+		case TokenType::less_tok:
+			return a < b;
+		case TokenType::less_equal_tok:
+			return !(a > b);
+		default:
+			return std::nullopt;
+	}
+}
+
+}  // namespace
+
+auto ConstantFolder::fold(std::span<Stmt> program) -> void {
+	for (auto& stmt : program) {
+		statement(stmt);
+	}
+}
+
+auto ConstantFolder::fold(Expr& expr) -> void {
+	expr = std::visit([this](auto node) -> Expr { return rewrite(node); }, expr);
+}
+
+auto ConstantFolder::statement(Stmt& stmt) -> void {
+	std::visit([this](auto& node) { visit(*node); }, stmt);
+}
+
+auto ConstantFolder::visit(Expression& stmt) -> void { fold(stmt.expression); }
+
+auto ConstantFolder::visit(Print& stmt) -> void { fold(stmt.expression); }
+
+auto ConstantFolder::visit(Var& stmt) -> void { fold(stmt.initializer); }
+
+auto ConstantFolder::visit(Block& stmt) -> void { fold(stmt.statements); }
+
+auto ConstantFolder::visit(If& stmt) -> void {
+	fold(stmt.condition);
+	statement(stmt.then_branch);
+	if (stmt.else_branch) {
+		statement(*stmt.else_branch);
+	}
+}
+
+auto ConstantFolder::visit(While& stmt) -> void {
+	fold(stmt.condition);
+	statement(stmt.body);
+}
+
+auto ConstantFolder::visit(Class& stmt) -> void {}
+
+auto ConstantFolder::rewrite(Box<Unary> expr) -> Expr {
+	fold(expr->right);
+	const auto* right = literal_value(expr->right);
+	if (right == nullptr) {
+		return expr;
+	}
+	if (expr->op.get_type() == TokenType::bang_tok) {
+		eliminated_++;
+		return literal(is_falsey(*right));
+	}
+	if (expr->op.get_type() == TokenType::minus_tok && std::holds_alternative<double>(*right)) {
+		eliminated_++;
+		return literal(-std::get<double>(*right));
+	}
+	return expr;
+}
+
+auto ConstantFolder::rewrite(Box<Binary> expr) -> Expr {
+	fold(expr->left);
+	fold(expr->right);
+	const auto* left  = literal_value(expr->left);
+	const auto* right = literal_value(expr->right);
+	if (left == nullptr || right == nullptr) {
+		return expr;
+	}
+
+	auto op = expr->op.get_type();
+	std::optional<LiteralType> result;
+	if (op == TokenType::equal_equal_tok || op == TokenType::bang_equal_tok) {
+		// Same as Value's operator==: values of different types differ, NaN differs from itself
+		result = (*left == *right) == (op == TokenType::equal_equal_tok);
+	} else if (std::holds_alternative<double>(*left) && std::holds_alternative<double>(*right)) {
+		result = number_operation(op, std::get<double>(*left), std::get<double>(*right));
+	} else if (op == TokenType::plus_tok && std::holds_alternative<std::string_view>(*left) &&
+	           std::holds_alternative<std::string_view>(*right)) {
+		auto a      = std::get<std::string_view>(*left);
+		auto b      = std::get<std::string_view>(*right);
+		auto* chars = static_cast<char*>(arena_->allocate(a.size() + b.size(), 1));
+		std::memcpy(chars, a.data(), a.size());
+		std::memcpy(chars + a.size(), b.data(), b.size());
+		result = std::string_view{chars, a.size() + b.size()};
+	}
+	if (!result) {
+		return expr;
+	}
+	eliminated_ += 2;
+	return literal(std::move(*result));
+}
+
+auto ConstantFolder::rewrite(Box<Grouping> expr) -> Expr {
+	fold(expr->expression);
+	eliminated_++;
+	return expr->expression;
+}
+
+auto ConstantFolder::rewrite(Box<Literal> expr) -> Expr { return expr; }
+
+auto ConstantFolder::rewrite(Box<Variable> expr) -> Expr { return expr; }
+
+// `and` yields its left operand when that is falsey, `or` when it is truthy, otherwise the right operand
+auto ConstantFolder::rewrite(Box<Logical> expr) -> Expr {
+	fold(expr->left);
+	const auto* left = literal_value(expr->left);
+	if (left == nullptr) {
+		fold(expr->right);
+		return expr;
+	}
+	bool short_circuits = is_falsey(*left) == (expr->op.get_type() == TokenType::and_tok);
+	if (short_circuits) {
+		eliminated_ += 1 + count_nodes(expr->right);
+		return expr->left;
+	}
+	fold(expr->right);
+	eliminated_ += 2;
+	return expr->right;
+}
+
+auto ConstantFolder::rewrite(Box<Get> expr) -> Expr {
+	fold(expr->object);
+	return expr;
+}
+
+auto ConstantFolder::rewrite(Box<Set> expr) -> Expr {
+	fold(expr->object);
+	fold(expr->value);
+	return expr;
+}
+
+auto ConstantFolder::rewrite(Box<Call> expr) -> Expr {
+	fold(expr->callee);
+	for (auto& argument : expr->arguments) {
+		fold(argument);
+	}
+	return expr;
+}
+
+auto ConstantFolder::rewrite(Box<Assign> expr) -> Expr {
+	fold(expr->value);
+	return expr;
+}
+
+auto ConstantFolder::literal(LiteralType value) -> Expr { return make_box(*arena_, Literal{std::move(value)}); }
+
+auto count_nodes(const Expr& expr) -> std::size_t {
+	return std::visit(visit_overloader{[](const Box<Unary>& node) { return 1 + count_nodes(node->right); },
+	                                   [](const Box<Binary>& node) {
+		                                   return 1 + count_nodes(node->left) + count_nodes(node->right);
+	                                   },
+	                                   [](const Box<Grouping>& node) { return 1 + count_nodes(node->expression); },
+	                                   [](const Box<Logical>& node) {
+		                                   return 1 + count_nodes(node->left) + count_nodes(node->right);
+	                                   },
+	                                   [](const Box<Get>& node) { return 1 + count_nodes(node->object); },
+	                                   [](const Box<Set>& node) {
+		                                   return 1 + count_nodes(node->object) + count_nodes(node->value);
+	                                   },
+	                                   [](const Box<Call>& node) {
+		                                   std::size_t count = 1 + count_nodes(node->callee);
+		                                   for (const auto& argument : node->arguments) {
+			                                   count += count_nodes(argument);
+		                                   }
+		                                   return count;
+	                                   },
+	                                   [](const Box<Assign>& node) { return 1 + count_nodes(node->value); },
+	                                   [](const auto&) -> std::size_t { return 1; }},
+	                  expr);
+}
+
+}  // namespace lox
@@ -0,0 +1,55 @@
+#include "lox/diagnostics.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lox {
+
+auto Diagnostics::report(DiagnosticCode code, std::string_view span, unsigned int line, std::string_view message)
+    -> void {
+	unsigned int offset = 0;
+	unsigned int column = 0;
+	// Compared as addresses, span may come from anywhere when the source isn't known
+	auto first = reinterpret_cast<std::uintptr_t>(source_.data());
+	auto at    = reinterpret_cast<std::uintptr_t>(span.data());
+	if (!source_.empty() && at >= first && at <= first + source_.size()) {
+		offset = static_cast<unsigned int>(at - first);
+		column = column_of(offset);
+	}
+	entries_.push_back(Diagnostic{.code    = code,
+	                              .line    = line,
+	                              .column  = column,
+	                              .offset  = offset,
+	                              .length  = static_cast<unsigned int>(span.size()),
+	                              .message = message});
+}
+
+auto Diagnostics::column_of(unsigned int offset) -> unsigned int {
+	if (offset >= searched_) {
+		auto newline = source_.substr(searched_, offset - searched_).rfind('\n');
+		if (newline != std::string_view::npos) {
+			line_start_ = searched_ + static_cast<unsigned int>(newline) + 1;
+		}
+		searched_ = offset;
+	} else if (offset < line_start_) {
+		// An earlier line, such as the Parser reporting after the Scanner ran ahead
+		auto newline = source_.substr(0, offset).rfind('\n');
+		line_start_  = newline == std::string_view::npos ? 0 : static_cast<unsigned int>(newline) + 1;
+		searched_    = offset;
+	}
+	return offset - line_start_;
+}
+
+auto Diagnostics::format(const Diagnostic& diagnostic) const -> std::string {
+	std::string where;
+	if (diagnostic.length == 0) {
+		where = diagnostic.offset >= source_.size() ? " at end" : "";
+	} else if (!source_.empty()) {
+		where = " at '" + std::string{source_.substr(diagnostic.offset, diagnostic.length)} + "'";
+	}
+	return "[line " + std::to_string(diagnostic.line) + ":" + std::to_string(diagnostic.column) + "] Error" + where +
+	       ": " + std::string{diagnostic.message};
+}
+
+}  // namespace lox
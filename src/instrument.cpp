@@ -0,0 +1,161 @@
+#include "lox/instrument.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace lox::instrument {
+
+namespace {
+
+using Values = std::array<std::uint64_t, counter_count>;
+
+constexpr std::array<const char*, counter_count> counter_names = {"tokens", "ast_nodes", "box_allocations",
+                                                                  "box_bytes"};
+
+struct Event {
+	const char* category;
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::duration duration;
+	std::uint32_t thread;
+	Values deltas;
+};
+
+// Everything shared between threads, behind one lock.
+// Counters are never written from another thread: exiting threads fold theirs into `retired`
+// and reset() moves `baseline` up instead of clearing them.
+struct Registry {
+	std::mutex mutex;
+	std::vector<ThreadCounters*> live;
+	Values retired{};
+	Values baseline{};
+	std::uint32_t next_id = 1;
+	std::vector<Event> events;
+	const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+};
+
+auto registry() -> Registry& {
+	// Leaked so threads exiting after main() can still unregister
+	static auto* instance = new Registry;
+	return *instance;
+}
+
+auto snapshot(const ThreadCounters& counters) -> Values {
+	Values values;
+	for (std::size_t i = 0; i < counter_count; i++) {
+		values[i] = counters.values[i].load(std::memory_order_relaxed);
+	}
+	return values;
+}
+
+// Sum over every thread, the caller holds the lock
+auto total(const Registry& shared) -> Values {
+	auto values = shared.retired;
+	for (const auto* counters : shared.live) {
+		auto live = snapshot(*counters);
+		for (std::size_t i = 0; i < counter_count; i++) {
+			values[i] += live[i];
+		}
+	}
+	return values;
+}
+
+auto microseconds(std::chrono::steady_clock::duration duration) -> double {
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+ThreadCounters::ThreadCounters() {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	id = shared.next_id++;
+	shared.live.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	auto values = snapshot(*this);
+	for (std::size_t i = 0; i < counter_count; i++) {
+		shared.retired[i] += values[i];
+	}
+	std::erase(shared.live, this);
+}
+
+auto counts() -> Counts {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	auto values = total(shared);
+	return {.tokens          = values[0] - shared.baseline[0],
+	        .ast_nodes       = values[1] - shared.baseline[1],
+	        .box_allocations = values[2] - shared.baseline[2],
+	        .box_bytes       = values[3] - shared.baseline[3]};
+}
+
+auto reset() -> void {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	shared.baseline = total(shared);
+	shared.events.clear();
+}
+
+Scope::Scope(const char* category, const char* name)
+    : category_(category), name_(name), counts_at_start_(snapshot(thread_counters())),
+      start_(std::chrono::steady_clock::now()) {}
+
+Scope::~Scope() {
+	auto end       = std::chrono::steady_clock::now();
+	auto& counters = thread_counters();
+	auto deltas    = snapshot(counters);
+	for (std::size_t i = 0; i < counter_count; i++) {
+		deltas[i] -= counts_at_start_[i];
+	}
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	shared.events.push_back({category_, name_, start_, end - start_, counters.id, deltas});
+}
+
+auto event_count() -> std::size_t {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+	return shared.events.size();
+}
+
+auto write_chrome_trace(std::ostream& out) -> void {
+	auto& shared = registry();
+	std::scoped_lock lock{shared.mutex};
+
+	// Category and name are literals from LOX_INSTRUMENT_SCOPE, they need no escaping
+	out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+	auto last = shared.origin;
+	for (std::size_t i = 0; i < shared.events.size(); i++) {
+		const auto& event = shared.events[i];
+		out << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+		    << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.thread
+		    << ", \"ts\": " << microseconds(event.start - shared.origin)
+		    << ", \"dur\": " << microseconds(event.duration) << ", \"args\": {";
+		for (std::size_t c = 0; c < counter_count; c++) {
+			out << (c == 0 ? "\"" : ", \"") << counter_names[c] << "\": " << event.deltas[c];
+		}
+		out << "}}";
+		last = std::max(last, event.start + event.duration);
+	}
+
+	auto values = total(shared);
+	out << (shared.events.empty() ? "\n" : ",\n") << "  {\"name\": \"lox\", \"ph\": \"C\", \"pid\": 1, \"tid\": 0"
+	    << ", \"ts\": " << microseconds(last - shared.origin) << ", \"args\": {";
+	for (std::size_t c = 0; c < counter_count; c++) {
+		out << (c == 0 ? "\"" : ", \"") << counter_names[c] << "\": " << values[c] - shared.baseline[c];
+	}
+	out << "}}\n]}\n";
+}
+
+}  // namespace lox::instrument
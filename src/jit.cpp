@@ -0,0 +1,570 @@
+#include "lox/jit.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <lox/chunk.hpp>
+#include <lox/value.hpp>
+
+#if defined(LOX_JIT) && defined(__x86_64__) && defined(__linux__)
+#define LOX_JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace lox {
+
+JitCode::JitCode(JitCode&& other) noexcept
+    : memory_(std::exchange(other.memory_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+auto JitCode::operator=(JitCode&& other) noexcept -> JitCode& {
+	if (this != &other) {
+		this->~JitCode();
+		memory_ = std::exchange(other.memory_, nullptr);
+		size_   = std::exchange(other.size_, 0);
+	}
+	return *this;
+}
+
+#ifdef LOX_JIT_X86_64
+
+JitCode::~JitCode() {
+	if (memory_ != nullptr) {
+		::munmap(memory_, size_);
+	}
+}
+
+auto jit_supported() -> bool { return true; }
+
+namespace {
+
+// General purpose registers by encoding, only the low eight are used so no REX.R/REX.B is needed for them
+enum Gpr : std::uint8_t { rax = 0, rcx = 1, rdx = 2, rsi = 6, rdi = 7 };
+
+// Condition codes of jcc and setcc
+enum Condition : std::uint8_t { if_equal = 0x4, if_above = 0x7, if_not_parity = 0xb };
+
+// xmm0..xmm14 hold the operand stack, slot i in xmm i, xmm15 is scratch
+constexpr int max_depth           = 15;
+constexpr int scratch             = 15;
+constexpr std::uint64_t quiet_nan = 0x7ffc000000000000;
+
+// Just enough of an x86-64 encoder for the templates below
+class Assembler {
+private:
+	std::vector<std::uint8_t> bytes_;
+
+	auto modrm(int mod, int reg, int rm) -> void {
+		byte(static_cast<std::uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+	}
+	// prefix [REX] 0F opcode modrm for SSE instructions on two xmm registers or an xmm and a gpr
+	auto sse(std::uint8_t prefix, bool wide, std::uint8_t opcode, int reg, int rm) -> void {
+		byte(prefix);
+		auto rex = (wide ? 0x48 : 0x40) | (reg >= 8 ? 0x4 : 0) | (rm >= 8 ? 0x1 : 0);
+		if (rex != 0x40) {
+			byte(static_cast<std::uint8_t>(rex));
+		}
+		byte(0x0f);
+		byte(opcode);
+		modrm(3, reg, rm);
+	}
+
+public:
+	[[nodiscard]] auto size() const -> std::size_t { return bytes_.size(); }
+	[[nodiscard]] auto bytes() const -> const std::vector<std::uint8_t>& { return bytes_; }
+
+	auto byte(std::uint8_t value) -> void { bytes_.push_back(value); }
+	auto u32(std::uint32_t value) -> void {
+		for (int i = 0; i < 4; i++) {
+			byte(static_cast<std::uint8_t>(value >> (8 * i)));
+		}
+	}
+	auto patch_u32(std::size_t at, std::uint32_t value) -> void {
+		for (int i = 0; i < 4; i++) {
+			bytes_[at + static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(value >> (8 * i));
+		}
+	}
+
+	// movabs reg, imm64
+	auto mov(Gpr reg, std::uint64_t value) -> void {
+		byte(0x48);
+		byte(static_cast<std::uint8_t>(0xb8 + reg));
+		for (int i = 0; i < 8; i++) {
+			byte(static_cast<std::uint8_t>(value >> (8 * i)));
+		}
+	}
+	// mov reg, [base + displacement], base must not be rsp or r12
+	auto load(Gpr reg, Gpr base, std::int32_t displacement) -> void {
+		byte(0x48);
+		byte(0x8b);
+		modrm(2, reg, base);
+		u32(static_cast<std::uint32_t>(displacement));
+	}
+	// op rm, reg for the two operand ALU forms: 0x01 add, 0x21 and, 0x39 cmp, 0x89 mov
+	auto alu(std::uint8_t opcode, Gpr rm, Gpr reg) -> void {
+		byte(0x48);
+		byte(opcode);
+		modrm(3, reg, rm);
+	}
+	auto xor_rax(std::uint8_t value) -> void {
+		byte(0x48);
+		byte(0x83);
+		modrm(3, 6, rax);
+		byte(value);
+	}
+	// btc rax, 63 flips the sign of the double in rax
+	auto flip_sign_rax() -> void {
+		byte(0x48);
+		byte(0x0f);
+		byte(0xba);
+		modrm(3, 7, rax);
+		byte(63);
+	}
+	auto setcc(Condition condition, Gpr reg) -> void {
+		byte(0x0f);
+		byte(static_cast<std::uint8_t>(0x90 | condition));
+		modrm(3, 0, reg);
+	}
+	// and al, cl
+	auto and_al_cl() -> void {
+		byte(0x20);
+		modrm(3, rcx, rax);
+	}
+	// movzx eax, al
+	auto zero_extend_al() -> void {
+		byte(0x0f);
+		byte(0xb6);
+		modrm(3, rax, rax);
+	}
+	// Returns where the rel32 to patch starts
+	auto jcc(Condition condition) -> std::size_t {
+		byte(0x0f);
+		byte(static_cast<std::uint8_t>(0x80 | condition));
+		u32(0);
+		return size() - 4;
+	}
+	auto jmp() -> std::size_t {
+		byte(0xe9);
+		u32(0);
+		return size() - 4;
+	}
+	auto ret() -> void { byte(0xc3); }
+
+	auto movq_to_xmm(int xmm, Gpr reg) -> void { sse(0x66, true, 0x6e, xmm, reg); }
+	auto movq_from_xmm(Gpr reg, int xmm) -> void { sse(0x66, true, 0x7e, xmm, reg); }
+	auto addsd(int a, int b) -> void { sse(0xf2, false, 0x58, a, b); }
+	auto mulsd(int a, int b) -> void { sse(0xf2, false, 0x59, a, b); }
+	auto subsd(int a, int b) -> void { sse(0xf2, false, 0x5c, a, b); }
+	auto divsd(int a, int b) -> void { sse(0xf2, false, 0x5e, a, b); }
+	auto ucomisd(int a, int b) -> void { sse(0x66, false, 0x2e, a, b); }
+};
+
+enum class Type : std::uint8_t { number, boolean };
+
+// Static types of the operand stack at one point of the region
+using Stack = std::vector<Type>;
+
+// Translates a region in one forward pass. Jumps only go forward within the region,
+// the stack types where they land must match those of the fall through path
+class Translator {
+private:
+	std::span<const std::uint8_t> code_;
+	std::span<const Value> constants_;
+	std::span<Value* const> globals_;
+	Assembler out_;
+	Stack stack_;
+	bool reachable_ = true;
+
+	struct PendingJump {
+		std::size_t target;  // offset in the region's bytecode
+		std::size_t patch;   // rel32 to patch in the native code
+		Stack stack;
+		bool landed = false;
+	};
+	std::vector<PendingJump> jumps_;
+	std::vector<std::size_t> guard_patches_;
+
+	[[nodiscard]] auto depth() const -> int { return static_cast<int>(stack_.size()); }
+	[[nodiscard]] auto top() const -> int { return depth() - 1; }
+
+	auto push(Type type) -> bool {
+		if (depth() == max_depth) {
+			return false;
+		}
+		stack_.push_back(type);
+		return true;
+	}
+
+	// Number check of a NaN boxed value in rax, rsi holds quiet_nan all along
+	auto guard_number() -> void {
+		out_.alu(0x89, rdx, rax);
+		out_.alu(0x21, rdx, rsi);
+		out_.alu(0x39, rdx, rsi);
+		guard_patches_.push_back(out_.jcc(if_equal));
+	}
+
+	auto load_constant(int xmm, Value value) -> void {
+		out_.mov(rax, value.bits());
+		out_.movq_to_xmm(xmm, rax);
+	}
+
+	// Boxes the 0 or 1 in al as a Lox boolean into xmm
+	auto box_bool(int xmm) -> void {
+		out_.zero_extend_al();
+		out_.mov(rcx, Value{false}.bits());
+		out_.alu(0x01, rax, rcx);
+		out_.movq_to_xmm(xmm, rax);
+	}
+
+	auto constant(std::uint16_t index, int xmm, Type& type) -> bool {
+		if (index >= constants_.size()) {
+			return false;
+		}
+		Value value = constants_[index];
+		if (!value.is_number() && !value.is_bool()) {
+			return false;
+		}
+		type = value.is_number() ? Type::number : Type::boolean;
+		load_constant(xmm, value);
+		return true;
+	}
+
+	auto arithmetic(std::uint8_t op, int a, int b) -> void {
+		switch (static_cast<OpCode>(op)) {
+			case OpCode::add_op:
+			case OpCode::add_local_op:
+			case OpCode::add_constant_op:
+				out_.addsd(a, b);
+				break;
+			case OpCode::subtract_op:
+				out_.subsd(a, b);
+				break;
+			case OpCode::multiply_op:
+				out_.mulsd(a, b);
+				break;
+			default:
+				out_.divsd(a, b);
+				break;
+		}
+	}
+
+	// a == b into xmm a following Value's operator==: IEEE for two numbers, identity otherwise
+	auto equal(int a, Type a_type, int b, Type b_type) -> void {
+		if (a_type != b_type) {
+			load_constant(a, Value{false});
+		} else if (a_type == Type::number) {
+			out_.ucomisd(a, b);
+			out_.setcc(if_equal, rax);
+			out_.setcc(if_not_parity, rcx);
+			out_.and_al_cl();
+			box_bool(a);
+		} else {
+			out_.movq_from_xmm(rax, a);
+			out_.movq_from_xmm(rcx, b);
+			out_.alu(0x39, rax, rcx);
+			out_.setcc(if_equal, rax);
+			box_bool(a);
+		}
+	}
+
+	// a > b into xmm a, false when either is NaN
+	auto greater(int a, int b, int result) -> void {
+		out_.ucomisd(a, b);
+		out_.setcc(if_above, rax);
+		box_bool(result);
+	}
+
+	auto read_u16(std::size_t at) const -> std::uint16_t {
+		return static_cast<std::uint16_t>((code_[at] << 8) | code_[at + 1]);
+	}
+
+	// Emits one instruction, false when the region can't be translated
+	auto instruction(std::size_t& pc) -> bool {
+		auto op = code_[pc++];
+		auto operand_u8 = [&]() -> std::optional<std::uint8_t> {
+			if (pc + 1 > code_.size()) {
+				return std::nullopt;
+			}
+			return code_[pc++];
+		};
+		auto operand_u16 = [&]() -> std::optional<std::uint16_t> {
+			if (pc + 2 > code_.size()) {
+				return std::nullopt;
+			}
+			pc += 2;
+			return read_u16(pc - 2);
+		};
+
+		switch (static_cast<OpCode>(op)) {
+			case OpCode::constant_op: {
+				auto index = operand_u16();
+				Type type{};
+				if (!index || !push(Type::number) || !constant(*index, top(), type)) {
+					return false;
+				}
+				stack_.back() = type;
+				return true;
+			}
+			case OpCode::true_op:
+			case OpCode::false_op:
+				if (!push(Type::boolean)) {
+					return false;
+				}
+				load_constant(top(), Value{static_cast<OpCode>(op) == OpCode::true_op});
+				return true;
+			case OpCode::get_local_op: {
+				auto slot = operand_u8();
+				if (!slot || !push(Type::number)) {
+					return false;
+				}
+				out_.load(rax, rdi, static_cast<std::int32_t>(*slot * sizeof(Value)));
+				guard_number();
+				out_.movq_to_xmm(top(), rax);
+				return true;
+			}
+			case OpCode::get_global_op: {
+				auto slot = operand_u16();
+				if (!slot || *slot >= globals_.size() || !push(Type::number)) {
+					return false;
+				}
+				// Global slots never move while the VM lives, undefined ones are empty and fail the guard
+				out_.mov(rax, reinterpret_cast<std::uintptr_t>(globals_[*slot]));
+				out_.load(rax, rax, 0);
+				guard_number();
+				out_.movq_to_xmm(top(), rax);
+				return true;
+			}
+			case OpCode::pop_op:
+				if (stack_.empty()) {
+					return false;
+				}
+				stack_.pop_back();
+				return true;
+			case OpCode::add_op:
+			case OpCode::subtract_op:
+			case OpCode::multiply_op:
+			case OpCode::divide_op:
+				if (depth() < 2 || stack_[top()] != Type::number || stack_[top() - 1] != Type::number) {
+					return false;
+				}
+				arithmetic(op, top() - 1, top());
+				stack_.pop_back();
+				return true;
+			case OpCode::add_local_op: {
+				auto slot = operand_u8();
+				if (!slot || stack_.empty() || stack_.back() != Type::number) {
+					return false;
+				}
+				out_.load(rax, rdi, static_cast<std::int32_t>(*slot * sizeof(Value)));
+				guard_number();
+				out_.movq_to_xmm(scratch, rax);
+				arithmetic(op, top(), scratch);
+				return true;
+			}
+			case OpCode::add_constant_op: {
+				auto index = operand_u16();
+				Type type{};
+				if (!index || stack_.empty() || stack_.back() != Type::number || !constant(*index, scratch, type) ||
+				    type != Type::number) {
+					return false;
+				}
+				arithmetic(op, top(), scratch);
+				return true;
+			}
+			case OpCode::equal_op:
+				if (depth() < 2) {
+					return false;
+				}
+				equal(top() - 1, stack_[top() - 1], top(), stack_[top()]);
+				stack_.pop_back();
+				stack_.back() = Type::boolean;
+				return true;
+			case OpCode::equal_constant_op: {
+				auto index = operand_u16();
+				Type type{};
+				if (!index || stack_.empty() || !constant(*index, scratch, type)) {
+					return false;
+				}
+				equal(top(), stack_.back(), scratch, type);
+				stack_.back() = Type::boolean;
+				return true;
+			}
+			case OpCode::greater_op:
+			case OpCode::less_op: {
+				if (depth() < 2 || stack_[top()] != Type::number || stack_[top() - 1] != Type::number) {
+					return false;
+				}
+				auto a = top() - 1;
+				auto b = top();
+				// a < b is b > a
+				static_cast<OpCode>(op) == OpCode::greater_op ? greater(a, b, a) : greater(b, a, a);
+				stack_.pop_back();
+				stack_.back() = Type::boolean;
+				return true;
+			}
+			case OpCode::greater_constant_op:
+			case OpCode::less_constant_op: {
+				auto index = operand_u16();
+				Type type{};
+				if (!index || stack_.empty() || stack_.back() != Type::number || !constant(*index, scratch, type) ||
+				    type != Type::number) {
+					return false;
+				}
+				static_cast<OpCode>(op) == OpCode::greater_constant_op ? greater(top(), scratch, top())
+				                                                       : greater(scratch, top(), top());
+				stack_.back() = Type::boolean;
+				return true;
+			}
+			case OpCode::not_op:
+				if (stack_.empty()) {
+					return false;
+				}
+				if (stack_.back() == Type::number) {
+					// Numbers are always truthy
+					load_constant(top(), Value{false});
+				} else {
+					// false and true differ in the lowest bit
+					out_.movq_from_xmm(rax, top());
+					out_.xor_rax(1);
+					out_.movq_to_xmm(top(), rax);
+				}
+				stack_.back() = Type::boolean;
+				return true;
+			case OpCode::negate_op:
+				if (stack_.empty() || stack_.back() != Type::number) {
+					return false;
+				}
+				out_.movq_from_xmm(rax, top());
+				out_.flip_sign_rax();
+				out_.movq_to_xmm(top(), rax);
+				return true;
+			case OpCode::jump_op: {
+				auto offset = operand_u16();
+				if (!offset) {
+					return false;
+				}
+				jumps_.push_back({pc + *offset, out_.jmp(), stack_});
+				reachable_ = false;
+				return true;
+			}
+			case OpCode::jump_if_false_op: {
+				auto offset = operand_u16();
+				if (!offset || stack_.empty()) {
+					return false;
+				}
+				// Numbers are truthy, the jump is never taken
+				if (stack_.back() == Type::boolean) {
+					out_.movq_from_xmm(rax, top());
+					out_.mov(rcx, Value{false}.bits());
+					out_.alu(0x39, rax, rcx);
+					jumps_.push_back({pc + *offset, out_.jcc(if_equal), stack_});
+				}
+				return true;
+			}
+			default:
+				return false;
+		}
+	}
+
+	// Joins the jumps landing at pc with the fall through path
+	auto land(std::size_t pc) -> bool {
+		for (auto& jump : jumps_) {
+			if (jump.target != pc) {
+				continue;
+			}
+			if (!reachable_) {
+				stack_     = jump.stack;
+				reachable_ = true;
+			} else if (jump.stack != stack_) {
+				return false;
+			}
+			auto distance = static_cast<std::int64_t>(out_.size()) - static_cast<std::int64_t>(jump.patch + 4);
+			out_.patch_u32(jump.patch, static_cast<std::uint32_t>(static_cast<std::int32_t>(distance)));
+			jump.landed = true;
+		}
+		return true;
+	}
+
+public:
+	Translator(std::span<const std::uint8_t> code, std::span<const Value> constants, std::span<Value* const> globals)
+	    : code_(code), constants_(constants), globals_(globals) {}
+
+	auto translate() -> std::optional<std::vector<std::uint8_t>> {
+		out_.mov(rsi, quiet_nan);
+		std::size_t pc = 0;
+		while (pc < code_.size()) {
+			if (!land(pc)) {
+				return std::nullopt;
+			}
+			if (!reachable_) {
+				pc += 1 + operand_size(static_cast<OpCode>(code_[pc]));
+				continue;
+			}
+			if (!instruction(pc)) {
+				return std::nullopt;
+			}
+		}
+		if (!land(code_.size()) || !reachable_ || depth() != 1) {
+			return std::nullopt;
+		}
+		// A jump into the middle of an instruction or out of the region never landed
+		for (const auto& jump : jumps_) {
+			if (!jump.landed) {
+				return std::nullopt;
+			}
+		}
+		out_.movq_from_xmm(rax, 0);
+		out_.ret();
+
+		// Every guard lands on the shared bail out
+		for (auto patch : guard_patches_) {
+			out_.patch_u32(patch, static_cast<std::uint32_t>(out_.size() - (patch + 4)));
+		}
+		out_.mov(rax, jit_guard_failed);
+		out_.ret();
+		return out_.bytes();
+	}
+};
+
+}  // namespace
+
+auto jit_compile(std::span<const std::uint8_t> code, std::span<const Value> constants, std::span<Value* const> globals)
+    -> std::optional<JitCode> {
+	auto native = Translator{code, constants, globals}.translate();
+	if (!native) {
+		return std::nullopt;
+	}
+	auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+	auto size = (native->size() + page - 1) / page * page;
+	void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return std::nullopt;
+	}
+	std::memcpy(memory, native->data(), native->size());
+	// Never writable and executable at the same time
+	if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+		::munmap(memory, size);
+		return std::nullopt;
+	}
+	return JitCode{memory, size};
+}
+
+#else
+
+JitCode::~JitCode() = default;
+
+auto jit_supported() -> bool { return false; }
+
+auto jit_compile(std::span<const std::uint8_t> /*code*/, std::span<const Value> /*constants*/,
+                 std::span<Value* const> /*globals*/) -> std::optional<JitCode> {
+	return std::nullopt;
+}
+
+#endif
+
+}  // namespace lox
@@ -0,0 +1,319 @@
+#include "lox/object.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <lox/value.hpp>
+
+namespace lox {
+
+namespace {
+
+auto object_size(const Obj* object) -> std::size_t {
+	switch (object->type) {
+		case ObjType::string_obj:
+			return sizeof(ObjString) + static_cast<const ObjString*>(object)->chars.capacity();
+		case ObjType::class_obj:
+			return sizeof(ObjClass);
+		case ObjType::instance_obj:
+			return sizeof(ObjInstance) + static_cast<const ObjInstance*>(object)->fields.capacity() * sizeof(Value);
+	}
+	return 0;
+}
+
+constexpr auto unlimited = std::numeric_limits<std::size_t>::max();
+
+}  // namespace
+
+ObjInstance::ObjInstance(ObjClass* instance_class, Shape* empty)
+    : Obj{ObjType::instance_obj}, klass(instance_class), shape(empty) {}
+
+ObjInstance::~ObjInstance() = default;
+
+Heap::Heap(GcConfig config) : config_(std::move(config)) {
+	stats_.next_gc = config_.initial_heap_size;
+	shapes_.push_back(std::make_unique<Shape>());
+}
+
+Heap::~Heap() {
+	while (objects_ != nullptr) {
+		auto* next = objects_->next;
+		destroy(objects_);
+		objects_ = next;
+	}
+}
+
+// New objects carry the current mark: black during a cycle, white once the next cycle flips the bit
+auto Heap::track(Obj* object, std::size_t size) -> void {
+	object->marked = mark_bit_;
+	object->next   = objects_;
+	objects_       = object;
+	stats_.bytes_allocated += size;
+}
+
+// Runs before linking a new object, whatever it is built from isn't reachable from a root yet
+auto Heap::before_allocation() -> void {
+	if (config_.stress) {
+		collect();
+	} else if (config_.mode == GcMode::incremental) {
+		if (phase_ != Phase::idle || stats_.bytes_allocated > stats_.next_gc) {
+			step();
+		}
+	} else if (stats_.bytes_allocated > stats_.next_gc) {
+		collect();
+	}
+}
+
+auto Heap::make_string(std::string text) -> ObjString* {
+	if (auto it = strings_.find(text); it != strings_.end()) {
+		return found_interned(it->second);
+	}
+	before_allocation();
+	auto* string = new ObjString(std::move(text));
+	track(string, object_size(string));
+	strings_.emplace(string->chars, string);
+	return string;
+}
+
+auto Heap::intern(std::string_view text) -> ObjString* {
+	if (auto it = strings_.find(text); it != strings_.end()) {
+		return found_interned(it->second);
+	}
+	return make_string(std::string{text});
+}
+
+auto Heap::make_class(ObjString* name) -> ObjClass* {
+	before_allocation();
+	auto* klass = new ObjClass(name);
+	track(klass, object_size(klass));
+	return klass;
+}
+
+// The instance is born black and never traced this cycle, the class may be white and no longer
+// referenced from anywhere else once the caller replaces it with the instance
+auto Heap::make_instance(ObjClass* klass) -> ObjInstance* {
+	before_allocation();
+	auto* instance = new ObjInstance(klass, empty_shape());
+	track(instance, object_size(instance));
+	if (phase_ == Phase::marking) {
+		mark(klass);
+	}
+	return instance;
+}
+
+auto Heap::transition(Shape* shape, ObjString* name) -> Shape* {
+	for (auto [key, next] : shape->transitions) {
+		if (key == name) {
+			return next;
+		}
+	}
+	auto& next  = shapes_.emplace_back(std::make_unique<Shape>());
+	next->parent = shape;
+	next->key    = name;
+	next->keys   = shape->keys;
+	next->keys.push_back(name);
+	shape->transitions.emplace_back(name, next.get());
+	// The new name may only be reachable from this shape from now on
+	if (phase_ == Phase::marking) {
+		mark(name);
+	}
+	return next.get();
+}
+
+// Growth of the field storage is accounted so the instance's size matches what sweep subtracts
+auto Heap::add_field(ObjInstance* instance, Shape* next, Value value) -> void {
+	auto before = instance->fields.capacity();
+	instance->fields.push_back(value);
+	stats_.bytes_allocated += (instance->fields.capacity() - before) * sizeof(Value);
+	instance->shape = next;
+}
+
+// The weak intern table can hand out a string the running cycle has not reached.
+// While marking it is shaded like any new reference, while sweeping an unmarked string is dead
+// but not freed yet and is revived, which is safe because strings reference nothing.
+auto Heap::found_interned(ObjString* string) -> ObjString* {
+	if (phase_ == Phase::marking) {
+		mark(string);
+	} else if (phase_ == Phase::sweeping) {
+		string->marked = mark_bit_;
+	}
+	return string;
+}
+
+auto Heap::mark(Obj* object) -> void {
+	if (object == nullptr || object->marked == mark_bit_) {
+		return;
+	}
+	object->marked = mark_bit_;
+	gray_.push_back(object);
+}
+
+auto Heap::mark(Value value) -> void {
+	if (value.is_obj()) {
+		mark(value.as_obj());
+	}
+}
+
+auto Heap::collect() -> void {
+	auto start = std::chrono::steady_clock::now();
+	if (phase_ == Phase::idle) {
+		// Nothing ran since the roots were marked, no need to rescan them
+		begin_cycle();
+		trace(unlimited);
+		start_sweeping();
+	} else if (phase_ == Phase::marking) {
+		trace(unlimited);
+		finish_marking();
+	}
+	sweep(unlimited);
+	finish_cycle();
+	record_pause(start);
+}
+
+auto Heap::step() -> void {
+	auto start = std::chrono::steady_clock::now();
+	if (phase_ == Phase::idle) {
+		begin_cycle();
+	}
+	auto budget = config_.step_budget;
+	if (phase_ == Phase::marking) {
+		budget -= trace(budget);
+		if (gray_.empty()) {
+			finish_marking();
+		}
+	}
+	if (phase_ == Phase::sweeping && budget > 0) {
+		sweep(budget);
+		if (*sweep_link_ == nullptr) {
+			finish_cycle();
+		}
+	}
+	stats_.steps++;
+	record_pause(start);
+}
+
+// Flipping the mark bit turns every object white, then the roots are shaded gray
+auto Heap::begin_cycle() -> void {
+	mark_bit_ = !mark_bit_;
+	phase_    = Phase::marking;
+	mark_shapes();
+	if (mark_roots_) {
+		mark_roots_(*this);
+	}
+}
+
+// Blackens up to budget gray objects, returns how many
+auto Heap::trace(std::size_t budget) -> std::size_t {
+	std::size_t done = 0;
+	while (done < budget && !gray_.empty()) {
+		auto* object = gray_.back();
+		gray_.pop_back();
+		blacken(object);
+		done++;
+	}
+	return done;
+}
+
+// Roots without a write barrier changed freely since the cycle began, rescanning them ends marking
+auto Heap::finish_marking() -> void {
+	remarking_ = true;
+	if (mark_roots_) {
+		mark_roots_(*this);
+	}
+	remarking_ = false;
+	trace(unlimited);
+	start_sweeping();
+}
+
+auto Heap::start_sweeping() -> void {
+	phase_      = Phase::sweeping;
+	sweep_link_ = &objects_;
+}
+
+// Frees unmarked objects among the next budget objects, returns how many were visited
+auto Heap::sweep(std::size_t budget) -> std::size_t {
+	std::size_t done = 0;
+	while (done < budget && *sweep_link_ != nullptr) {
+		auto* object = *sweep_link_;
+		done++;
+		if (object->marked == mark_bit_) {
+			sweep_link_ = &object->next;
+			continue;
+		}
+		*sweep_link_ = object->next;
+		if (object->type == ObjType::string_obj) {
+			strings_.erase(static_cast<ObjString*>(object)->chars);
+		}
+		auto size = object_size(object);
+		stats_.bytes_allocated -= size;
+		stats_.bytes_freed += size;
+		stats_.objects_freed++;
+		destroy(object);
+	}
+	return done;
+}
+
+auto Heap::finish_cycle() -> void {
+	phase_      = Phase::idle;
+	sweep_link_ = nullptr;
+	stats_.next_gc = std::max(config_.initial_heap_size,
+	                          static_cast<std::size_t>(static_cast<double>(stats_.bytes_allocated) * config_.growth_factor));
+	stats_.collections++;
+}
+
+auto Heap::record_pause(std::chrono::steady_clock::time_point start) -> void {
+	stats_.last_pause = std::chrono::steady_clock::now() - start;
+	stats_.max_pause  = std::max(stats_.max_pause, stats_.last_pause);
+	stats_.total_pause += stats_.last_pause;
+	if (config_.on_pause) {
+		config_.on_pause(stats_.last_pause);
+	}
+}
+
+// A field name must outlive every shape holding it, or a new string with the same text
+// would get a different pointer and miss the slot
+auto Heap::mark_shapes() -> void {
+	for (const auto& shape : shapes_) {
+		mark(shape->key);
+	}
+}
+
+// Marks everything object references, strings reference nothing
+auto Heap::blacken(Obj* object) -> void {
+	switch (object->type) {
+		case ObjType::string_obj:
+			break;
+		case ObjType::class_obj:
+			mark(static_cast<ObjClass*>(object)->name);
+			break;
+		case ObjType::instance_obj: {
+			auto* instance = static_cast<ObjInstance*>(object);
+			mark(instance->klass);
+			for (auto field : instance->fields) {
+				mark(field);
+			}
+			break;
+		}
+	}
+}
+
+auto Heap::destroy(Obj* object) -> void {
+	switch (object->type) {
+		case ObjType::string_obj:
+			delete static_cast<ObjString*>(object);
+			break;
+		case ObjType::class_obj:
+			delete static_cast<ObjClass*>(object);
+			break;
+		case ObjType::instance_obj:
+			delete static_cast<ObjInstance*>(object);
+			break;
+	}
+}
+
+}  // namespace lox
@@ -1,142 +1,376 @@
 #include "lox/parser.hpp"
 
-#include <stdexcept>
+#include <array>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <lox/ast.hpp>
+#include <lox/instrument.hpp>
+#include <lox/scanner.hpp>
 #include <lox/tokens.hpp>
 
 namespace lox
 {
     Parser::Parser(std::span<Token> tokens) : tokens_(tokens) {}
 
+    Parser::Parser(std::span<Token> tokens, Arena &arena) : tokens_(tokens), arena_(&arena) {}
+
+    Parser::Parser(std::span<Token> tokens, Diagnostics &diagnostics)
+        : tokens_(tokens), diagnostics_(&diagnostics), first_error_(diagnostics.error_count()) {}
+
+    Parser::Parser(std::span<Token> tokens, Arena &arena, Diagnostics &diagnostics)
+        : tokens_(tokens), arena_(&arena), diagnostics_(&diagnostics), first_error_(diagnostics.error_count()) {}
+
+    Parser::Parser(Scanner &scanner) : Parser(scanner, own_arena_) {}
+
+    // The first token is pulled before counting so scanner errors in it aren't taken for syntax errors
+    Parser::Parser(Scanner &scanner, Arena &arena)
+        : scanner_(&scanner), current_token_(scanner.next_token()), arena_(&arena),
+          diagnostics_(&scanner.diagnostics()), first_error_(scanner.diagnostics().error_count()) {}
+
     // This parser expression for now, we will parse statements if desired
     auto Parser::parse_expression() -> std::span<Expr>
     {
+        LOX_INSTRUMENT_SCOPE("parser", "parse_expression");
         while (!is_at_end())
         {
             expressions_.push_back(expression());
+            // Expressions may be terminated like expression statements
+            match(TokenType::semicolon_tok);
+            if (panic_mode_)
+            {
+                synchronize();
+            }
         }
         return expressions_;
     }
 
-    auto Parser::or_expression() -> Expr
+    auto Parser::parse() -> std::span<Stmt>
     {
-        Expr expr = and_expression();
-        while (match({TokenType::or_tok}))
+        LOX_INSTRUMENT_SCOPE("parser", "parse");
+        while (!is_at_end())
         {
-            Token op = previous();
-            Expr right = and_expression();
-            expr = Logical{.left = expr, .right = right, .op = op};
+            statements_.push_back(declaration());
         }
-        return expr;
+        return statements_;
     }
 
-    auto Parser::and_expression() -> Expr
+    auto Parser::declaration() -> Stmt
     {
-        Expr expr = equality();
-        while (match({TokenType::and_tok}))
+        Stmt stmt = match(TokenType::var_tok) ? var_declaration() : match(TokenType::class_tok) ? class_declaration() : statement();
+        if (panic_mode_)
         {
-            Token op = previous();
-            Expr right = equality();
-            expr = Logical{.left = expr, .right = right, .op = op};
+            synchronize();
         }
-        return expr;
+        return stmt;
     }
 
-    auto Parser::equality() -> Expr
+    auto Parser::var_declaration() -> Stmt
     {
-        Expr expr = comparison();
-        while (match({TokenType::bang_equal_tok, TokenType::equal_equal_tok}))
+        Token name = consume(TokenType::identifier_tok, "expected variable name.");
+        // A declaration without initializer starts out as nil
+        Expr initializer = match(TokenType::equal_tok) ? expression() : make(Literal{{}});
+        consume(TokenType::semicolon_tok, "expected ; after variable declaration.");
+        return make_stmt(Var{.token = std::move(name), .initializer = std::move(initializer)});
+    }
+
+    // Classes have no methods yet, the body must be empty
+    auto Parser::class_declaration() -> Stmt
+    {
+        Token name = consume(TokenType::identifier_tok, "expected class name.");
+        consume(TokenType::left_brace_tok, "expected { before class body.");
+        consume(TokenType::right_brace_tok, "expected } after class body.");
+        return make_stmt(Class{.name = std::move(name)});
+    }
+
+    auto Parser::statement() -> Stmt
+    {
+        if (match(TokenType::print_tok))
+        {
+            return print_statement();
+        }
+        if (match(TokenType::left_brace_tok))
+        {
+            return block();
+        }
+        if (match(TokenType::if_tok))
+        {
+            return if_statement();
+        }
+        if (match(TokenType::while_tok))
+        {
+            return while_statement();
+        }
+        if (match(TokenType::for_tok))
         {
-            Token op = previous();
-            Expr right = comparison();
-            expr = Binary{.left = expr, .right = right, .op = op};
+            return for_statement();
         }
-        return expr;
+        return expression_statement();
+    }
+
+    auto Parser::print_statement() -> Stmt
+    {
+        Expr value = expression();
+        consume(TokenType::semicolon_tok, "expected ; after value.");
+        return make_stmt(Print{std::move(value)});
+    }
+
+    auto Parser::expression_statement() -> Stmt
+    {
+        Expr expr = expression();
+        consume(TokenType::semicolon_tok, "expected ; after expression.");
+        return make_stmt(Expression{std::move(expr)});
     }
 
-    auto Parser::comparison() -> Expr
+    auto Parser::block() -> Stmt
     {
-        Expr expr = term();
-        while (match({TokenType::greater_tok, TokenType::greater_equal_tok, TokenType::less_tok, TokenType::less_equal_tok}))
+        std::vector<Stmt> statements;
+        block_depth_++;
+        while (!check(TokenType::right_brace_tok) && !is_at_end())
         {
-            Token op = previous();
-            Expr right = term();
-            expr = Binary{.left = expr, .right = right, .op = op};
+            statements.push_back(declaration());
         }
-        return expr;
+        block_depth_--;
+        consume(TokenType::right_brace_tok, "expected } after block.");
+        return make_stmt(Block{arena_->make_array<Stmt>(statements)});
     }
 
-    auto Parser::term() -> Expr
+    auto Parser::if_statement() -> Stmt
     {
-        Expr expr = factor();
-        while (match({TokenType::minus_tok, TokenType::plus_tok}))
+        consume(TokenType::left_paren_tok, "expected ( after 'if'.");
+        Expr condition = expression();
+        consume(TokenType::right_paren_tok, "expected ) after if condition.");
+
+        Stmt then_branch = statement();
+        std::optional<Stmt> else_branch;
+        if (match(TokenType::else_tok))
         {
-            Token op = previous();
-            Expr right = factor();
-            expr = Binary{.left = expr, .right = right, .op = op};
+            else_branch = statement();
         }
-        return expr;
+        return make_stmt(If{.condition = std::move(condition), .then_branch = std::move(then_branch), .else_branch = std::move(else_branch)});
     }
 
-    auto Parser::factor() -> Expr
+    auto Parser::while_statement() -> Stmt
     {
-        Expr expr = unary();
-        while (match({TokenType::slash_tok, TokenType::star_tok}))
+        consume(TokenType::left_paren_tok, "expected ( after 'while'.");
+        Expr condition = expression();
+        consume(TokenType::right_paren_tok, "expected ) after condition.");
+        Stmt body = statement();
+        return make_stmt(While{.condition = std::move(condition), .body = std::move(body)});
+    }
+
+    // for loops are desugared into a while loop wrapped in blocks
+    auto Parser::for_statement() -> Stmt
+    {
+        consume(TokenType::left_paren_tok, "expected ( after 'for'.");
+        std::optional<Stmt> initializer;
+        if (match(TokenType::var_tok))
+        {
+            initializer = var_declaration();
+        }
+        else if (!match(TokenType::semicolon_tok))
+        {
+            initializer = expression_statement();
+        }
+
+        Expr condition = check(TokenType::semicolon_tok) ? make(Literal{LiteralType(true)}) : expression();
+        consume(TokenType::semicolon_tok, "expected ; after loop condition.");
+
+        std::optional<Expr> increment;
+        if (!check(TokenType::right_paren_tok))
+        {
+            increment = expression();
+        }
+        consume(TokenType::right_paren_tok, "expected ) after for clauses.");
+
+        Stmt body = statement();
+        if (increment)
+        {
+            std::vector<Stmt> statements{std::move(body), make_stmt(Expression{std::move(*increment)})};
+            body = make_stmt(Block{arena_->make_array<Stmt>(statements)});
+        }
+        body = make_stmt(While{.condition = std::move(condition), .body = std::move(body)});
+        if (initializer)
         {
-            Token op = previous();
-            Expr right = unary();
-            expr = Binary{.left = expr, .right = right, .op = op};
+            std::vector<Stmt> statements{std::move(*initializer), std::move(body)};
+            body = make_stmt(Block{arena_->make_array<Stmt>(statements)});
         }
-        return expr;
+        return body;
     }
 
-    auto Parser::unary() -> Expr
+    auto Parser::rule(TokenType type) -> const ParseRule &
     {
-        if (match({TokenType::bang_tok, TokenType::minus_tok}))
+        using enum Precedence;
+        static constexpr auto rules = []
         {
-            Token op = previous();
-            Expr right = unary();
-            return Unary{op, right};
-        }
-        return primary();
+            std::array<ParseRule, as_integer(TokenType::eof_tok) + 1> table{};
+            auto set = [&](TokenType type, ParseRule rule) { table[as_integer(type)] = rule; };
+            set(TokenType::left_paren_tok, {&Parser::grouping, &Parser::call, call_prec});
+            set(TokenType::dot_tok, {nullptr, &Parser::get_expression, call_prec});
+            set(TokenType::minus_tok, {&Parser::unary, &Parser::binary, term_prec});
+            set(TokenType::plus_tok, {nullptr, &Parser::binary, term_prec});
+            set(TokenType::slash_tok, {nullptr, &Parser::binary, factor_prec});
+            set(TokenType::star_tok, {nullptr, &Parser::binary, factor_prec});
+            set(TokenType::bang_tok, {&Parser::unary, nullptr, none_prec});
+            set(TokenType::bang_equal_tok, {nullptr, &Parser::binary, equality_prec});
+            set(TokenType::equal_equal_tok, {nullptr, &Parser::binary, equality_prec});
+            set(TokenType::greater_tok, {nullptr, &Parser::binary, comparison_prec});
+            set(TokenType::greater_equal_tok, {nullptr, &Parser::binary, comparison_prec});
+            set(TokenType::less_tok, {nullptr, &Parser::binary, comparison_prec});
+            set(TokenType::less_equal_tok, {nullptr, &Parser::binary, comparison_prec});
+            set(TokenType::equal_tok, {nullptr, &Parser::assignment, assignment_prec});
+            set(TokenType::and_tok, {nullptr, &Parser::logical, and_prec});
+            set(TokenType::or_tok, {nullptr, &Parser::logical, or_prec});
+            set(TokenType::identifier_tok, {&Parser::variable, nullptr, none_prec});
+            set(TokenType::number_tok, {&Parser::number_or_string, nullptr, none_prec});
+            set(TokenType::string_tok, {&Parser::number_or_string, nullptr, none_prec});
+            set(TokenType::false_tok, {&Parser::literal, nullptr, none_prec});
+            set(TokenType::true_tok, {&Parser::literal, nullptr, none_prec});
+            set(TokenType::nil_tok, {&Parser::literal, nullptr, none_prec});
+            return table;
+        }();
+        return rules[as_integer(type)];
     }
 
-    auto Parser::expression() -> Expr { return or_expression(); }
+    auto Parser::expression() -> Expr { return parse_precedence(Precedence::assignment_prec); }
 
-    auto Parser::primary() -> Expr
+    // Parses an operand, then keeps folding it into every infix operator binding at least as tight as precedence
+    // Errors leave a nil literal in place of the operand so the caller can carry on
+    auto Parser::parse_precedence(Precedence precedence) -> Expr
     {
-        if (match({TokenType::false_tok}))
+        // The '}' closing a block is not taken for the operand, block() still needs it
+        if (is_at_end() || (block_depth_ > 0 && check(TokenType::right_brace_tok)))
         {
-            return Literal{LiteralType(false)};
+            error_at(peek(), DiagnosticCode::expected_expression, "expected expression.");
+            return make(Literal{{}});
         }
-        if (match({TokenType::true_tok}))
+        // Any other offending token is consumed too, so every statement makes progress
+        PrefixFn prefix = rule(advance().get_type()).prefix;
+        if (prefix == nullptr)
         {
-            return Literal{LiteralType(true)};
+            error_at(previous(), DiagnosticCode::expected_expression, "expected expression.");
+            return make(Literal{{}});
         }
-        if (match({TokenType::nil_tok}))
+        Expr expr = (this->*prefix)();
+        for (;;)
         {
-            return Literal{{}};
+            const ParseRule &next = rule(peek().get_type());
+            if (next.infix == nullptr || precedence > next.precedence)
+            {
+                return expr;
+            }
+            advance();
+            expr = (this->*next.infix)(std::move(expr));
         }
-        if (match({TokenType::number_tok, TokenType::string_tok}))
+    }
+
+    auto Parser::grouping() -> Expr
+    {
+        Expr expr = expression();
+        consume(TokenType::right_paren_tok, "expected ) after expression.");
+        return make(Grouping{std::move(expr)});
+    }
+
+    auto Parser::unary() -> Expr
+    {
+        Token op = previous();
+        Expr right = parse_precedence(Precedence::unary_prec);
+        return make(Unary{std::move(op), std::move(right)});
+    }
+
+    auto Parser::literal() -> Expr
+    {
+        switch (previous().get_type())
         {
-            return Literal{previous().get_literal()};
+        case TokenType::false_tok:
+            return make(Literal{LiteralType(false)});
+        case TokenType::true_tok:
+            return make(Literal{LiteralType(true)});
+        default:
+            return make(Literal{{}});
         }
+    }
+
+    auto Parser::number_or_string() -> Expr { return make(Literal{previous().get_literal()}); }
+
+    auto Parser::variable() -> Expr { return make(Variable{previous()}); }
+
+    // Left associative: the right operand only takes operators binding tighter than op
+    auto Parser::binary(Expr left) -> Expr
+    {
+        Token op = previous();
+        auto precedence = static_cast<Precedence>(std::to_underlying(rule(op.get_type()).precedence) + 1);
+        Expr right = parse_precedence(precedence);
+        return make(Binary{.left = std::move(left), .right = std::move(right), .op = std::move(op)});
+    }
+
+    auto Parser::logical(Expr left) -> Expr
+    {
+        Token op = previous();
+        auto precedence = static_cast<Precedence>(std::to_underlying(rule(op.get_type()).precedence) + 1);
+        Expr right = parse_precedence(precedence);
+        return make(Logical{.left = std::move(left), .right = std::move(right), .op = std::move(op)});
+    }
 
-        if (match({TokenType::identifier_tok}))
+    // Right associative, a = b = c assigns c to b first
+    auto Parser::assignment(Expr left) -> Expr
+    {
+        Token equals = previous();
+        Expr value = parse_precedence(Precedence::assignment_prec);
+        if (auto *variable = std::get_if<Box<Variable>>(&left))
+        {
+            return make(Assign{.name = (*variable)->token, .value = std::move(value)});
+        }
+        if (auto *get = std::get_if<Box<Get>>(&left))
+        {
+            return make(Set{.object = (*get)->object, .name = (*get)->name, .value = std::move(value)});
+        }
+        // Reported without entering panic mode, the whole assignment has been parsed so nothing is out of sync
+        if (!panic_mode_)
         {
-            return Variable{previous()};
+            diagnostics_->report(DiagnosticCode::invalid_assignment_target, equals.get_lexeme(), equals.get_line(),
+                                 "invalid assignment target.");
         }
+        return value;
+    }
 
-        if (match({TokenType::left_paren_tok}))
+    auto Parser::call(Expr left) -> Expr
+    {
+        std::vector<Expr> arguments;
+        if (!check(TokenType::right_paren_tok))
         {
-            Expr expr = expression();
-            consume(TokenType::right_paren_tok, "expected ) after expression.");
-            return Grouping{expr};
+            do
+            {
+                if (arguments.size() == 255)
+                {
+                    error_at(peek(), DiagnosticCode::too_many_arguments, "can't have more than 255 arguments.");
+                }
+                arguments.push_back(expression());
+            } while (match(TokenType::comma_tok));
         }
+        Token paren = consume(TokenType::right_paren_tok, "expected ) after arguments.");
+        return make(Call{.callee = std::move(left), .paren = std::move(paren), .arguments = arena_->make_array<Expr>(arguments)});
+    }
 
-        std::cout << "I Failed to parse here:  " << tokens_[current_].to_string() << std::endl;
-        throw std::invalid_argument("Failed to parse primary");
+    auto Parser::get_expression(Expr left) -> Expr
+    {
+        Token name = consume(TokenType::identifier_tok, "expected property name after '.'.");
+        return make(Get{.object = std::move(left), .name = std::move(name)});
+    }
+
+    auto parse_program(std::string_view source, Arena &arena) -> std::expected<std::span<Stmt>, Diagnostics>
+    {
+        LOX_INSTRUMENT_SCOPE("parser", "parse_program");
+        Scanner scanner{source};
+        Parser parser{scanner, arena};
+        // The parser's statement list dies with it, the caller gets a copy in the arena
+        auto program = arena.make_array<Stmt>(parser.parse());
+        if (scanner.diagnostics().has_errors())
+        {
+            return std::unexpected(std::move(scanner.diagnostics()));
+        }
+        return program;
     }
 
 } // namespace lox
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "lox/program.hpp"
+
+#include <utility>
+
+#include <lox/arena.hpp>
+#include <lox/compiler.hpp>
+#include <lox/parser.hpp>
+
+namespace lox {
+
+auto compile_program(std::string_view source) -> std::expected<Program, Diagnostics> {
+	Arena arena;
+	auto program = parse_program(source, arena);
+	if (!program) {
+		return std::unexpected(std::move(program.error()));
+	}
+	return Program{Compiler{}.compile(*program)};
+}
+
+}  // namespace lox
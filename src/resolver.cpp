@@ -0,0 +1,168 @@
+#include "lox/resolver.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <variant>
+
+#include <lox/ast.hpp>
+#include <lox/instrument.hpp>
+#include <lox/lox.hpp>
+
+namespace lox {
+
+auto Resolver::resolve(std::span<Stmt> program) -> void {
+	LOX_INSTRUMENT_SCOPE("resolver", "resolve");
+	for (auto& stmt : program) {
+		statement(stmt);
+	}
+}
+
+auto Resolver::resolve(Expr& expr) -> void {
+	LOX_INSTRUMENT_SCOPE("resolver", "resolve");
+	expression(expr);
+}
+
+auto Resolver::statement(Stmt& stmt) -> void {
+	std::visit([this](auto& node) { visit(*node); }, stmt);
+}
+
+auto Resolver::expression(Expr& expr) -> void {
+	std::visit([this](auto& node) { visit(*node); }, expr);
+}
+
+auto Resolver::visit(Expression& stmt) -> void { expression(stmt.expression); }
+
+auto Resolver::visit(Print& stmt) -> void { expression(stmt.expression); }
+
+auto Resolver::visit(Var& stmt) -> void {
+	auto name = stmt.token.get_lexeme();
+	if (scope_depth_ == 0) {
+		expression(stmt.initializer);
+		stmt.binding = global(name);
+		return;
+	}
+
+	// Declared before the initializer so reading it there is caught, defined after
+	declare(name);
+	expression(stmt.initializer);
+	stmt.binding = define();
+}
+
+auto Resolver::visit(Class& stmt) -> void {
+	auto name = stmt.name.get_lexeme();
+	if (scope_depth_ == 0) {
+		stmt.binding = global(name);
+		return;
+	}
+	declare(name);
+	stmt.binding = define();
+}
+
+auto Resolver::visit(Block& stmt) -> void {
+	scope_depth_++;
+	for (auto& inner : stmt.statements) {
+		statement(inner);
+	}
+	scope_depth_--;
+	while (!locals_.empty() && locals_.back().depth > scope_depth_) {
+		locals_.pop_back();
+	}
+}
+
+auto Resolver::visit(If& stmt) -> void {
+	expression(stmt.condition);
+	statement(stmt.then_branch);
+	if (stmt.else_branch) {
+		statement(*stmt.else_branch);
+	}
+}
+
+auto Resolver::visit(While& stmt) -> void {
+	expression(stmt.condition);
+	statement(stmt.body);
+}
+
+auto Resolver::visit(Unary& expr) -> void { expression(expr.right); }
+
+auto Resolver::visit(Binary& expr) -> void {
+	expression(expr.left);
+	expression(expr.right);
+}
+
+auto Resolver::visit(Grouping& expr) -> void { expression(expr.expression); }
+
+auto Resolver::visit(Literal& expr) -> void {}
+
+auto Resolver::visit(Variable& expr) -> void { expr.binding = lookup(expr.token.get_lexeme()); }
+
+auto Resolver::visit(Logical& expr) -> void {
+	expression(expr.left);
+	expression(expr.right);
+}
+
+auto Resolver::visit(Get& expr) -> void { expression(expr.object); }
+
+auto Resolver::visit(Set& expr) -> void {
+	expression(expr.object);
+	expression(expr.value);
+}
+
+auto Resolver::visit(Call& expr) -> void {
+	expression(expr.callee);
+	for (auto& argument : expr.arguments) {
+		expression(argument);
+	}
+}
+
+auto Resolver::visit(Assign& expr) -> void {
+	expression(expr.value);
+	expr.binding = lookup(expr.name.get_lexeme());
+}
+
+// Adds a local to the innermost scope, it can't be read until define()
+auto Resolver::declare(std::string_view name) -> void {
+	for (auto it = locals_.rbegin(); it != locals_.rend() && it->depth >= scope_depth_; ++it) {
+		if (it->name == name) {
+			throw LoxException("Already a variable with this name in this scope.");
+		}
+	}
+	if (locals_.size() > std::numeric_limits<std::uint8_t>::max()) {
+		throw LoxException("Too many local variables in function.");
+	}
+	locals_.push_back({name, -1});
+}
+
+auto Resolver::define() -> Binding {
+	locals_.back().depth = scope_depth_;
+	return Binding{.kind = Binding::Kind::local, .depth = 0, .slot = static_cast<std::uint16_t>(locals_.size() - 1)};
+}
+
+// Innermost declaration wins, names declared in no enclosing block are globals
+auto Resolver::lookup(std::string_view name) -> Binding {
+	for (auto i = static_cast<int>(locals_.size()) - 1; i >= 0; i--) {
+		if (locals_[i].name == name) {
+			if (locals_[i].depth == -1) {
+				throw LoxException("Can't read local variable in its own initializer.");
+			}
+			return Binding{.kind  = Binding::Kind::local,
+			               .depth = static_cast<std::uint16_t>(scope_depth_ - locals_[i].depth),
+			               .slot  = static_cast<std::uint16_t>(i)};
+		}
+	}
+	auto binding  = global(name);
+	binding.depth = static_cast<std::uint16_t>(scope_depth_);
+	return binding;
+}
+
+auto Resolver::global(std::string_view name) -> Binding {
+	auto [it, inserted] = global_slots_.try_emplace(name, static_cast<std::uint16_t>(globals_.size()));
+	if (inserted) {
+		if (globals_.size() > std::numeric_limits<std::uint16_t>::max()) {
+			throw LoxException("Too many global variables.");
+		}
+		globals_.push_back(name);
+	}
+	return Binding{.kind = Binding::Kind::global, .depth = 0, .slot = it->second};
+}
+
+}  // namespace lox
@@ -0,0 +1,169 @@
+#include "lox/scan_kernels.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOX_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace lox {
+
+namespace scalar {
+
+auto skip_whitespace(const char* first, const char* last, unsigned int& newlines) -> const char* {
+	for (; first != last; ++first) {
+		switch (*first) {
+			case '\n':
+				newlines++;
+				[[fallthrough]];
+			case ' ':
+			case '\r':
+			case '\t':
+				continue;
+			default:
+				return first;
+		}
+	}
+	return last;
+}
+
+auto find_newline(const char* first, const char* last) -> const char* {
+	while (first != last && *first != '\n') {
+		++first;
+	}
+	return first;
+}
+
+auto find_quote(const char* first, const char* last, unsigned int& newlines) -> const char* {
+	for (; first != last && *first != '"'; ++first) {
+		newlines += *first == '\n' ? 1 : 0;
+	}
+	return first;
+}
+
+auto span_identifier(const char* first, const char* last) -> const char* {
+	for (; first != last; ++first) {
+		char c = *first;
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+			break;
+		}
+	}
+	return first;
+}
+
+auto span_digits(const char* first, const char* last) -> const char* {
+	while (first != last && *first >= '0' && *first <= '9') {
+		++first;
+	}
+	return first;
+}
+
+}  // namespace scalar
+
+#ifdef LOX_SCAN_X86
+
+namespace sse2 {
+
+using mask_t                         = std::uint32_t;
+constexpr std::ptrdiff_t width       = 16;
+constexpr mask_t full_mask           = 0xffff;
+
+inline auto load(const char* p) -> __m128i { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+
+inline auto eq(__m128i block, char c) -> mask_t {
+	return static_cast<mask_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c))));
+}
+
+// Signed compares are fine, bytes >= 0x80 are negative and never in an ASCII range
+inline auto in_range(__m128i block, char low, char high) -> mask_t {
+	auto above = _mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(low - 1)));
+	auto below = _mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(high + 1)));
+	return static_cast<mask_t>(_mm_movemask_epi8(_mm_and_si128(above, below)));
+}
+
+inline auto lower(__m128i block) -> __m128i { return _mm_or_si128(block, _mm_set1_epi8(0x20)); }
+
+#include "scan_kernels_impl.hpp"
+
+}  // namespace sse2
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+using mask_t                         = std::uint32_t;
+constexpr std::ptrdiff_t width       = 32;
+constexpr mask_t full_mask           = 0xffffffff;
+
+inline auto load(const char* p) -> __m256i { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+inline auto eq(__m256i block, char c) -> mask_t {
+	return static_cast<mask_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c))));
+}
+
+inline auto in_range(__m256i block, char low, char high) -> mask_t {
+	auto above = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(static_cast<char>(low - 1)));
+	auto below = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)), block);
+	return static_cast<mask_t>(_mm256_movemask_epi8(_mm256_and_si256(above, below)));
+}
+
+inline auto lower(__m256i block) -> __m256i { return _mm256_or_si256(block, _mm256_set1_epi8(0x20)); }
+
+#include "scan_kernels_impl.hpp"
+
+}  // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif  // LOX_SCAN_X86
+
+namespace {
+
+constexpr ScanKernels scalar_kernels{SimdLevel::scalar,     scalar::skip_whitespace, scalar::find_newline,
+                                     scalar::find_quote,    scalar::span_identifier, scalar::span_digits};
+
+#ifdef LOX_SCAN_X86
+// SSE2 is part of the x86-64 baseline, AVX2 has to be checked at runtime
+constexpr ScanKernels sse2_kernels{SimdLevel::sse2,   sse2::skip_whitespace, sse2::find_newline,
+                                   sse2::find_quote,  sse2::span_identifier, sse2::span_digits};
+constexpr ScanKernels avx2_kernels{SimdLevel::avx2,   avx2::skip_whitespace, avx2::find_newline,
+                                   avx2::find_quote,  avx2::span_identifier, avx2::span_digits};
+
+auto has_avx2() -> bool {
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+}
+#endif
+
+}  // namespace
+
+auto scan_kernels(SimdLevel level) -> const ScanKernels& {
+#ifdef LOX_SCAN_X86
+	if (level == SimdLevel::avx2 && has_avx2()) {
+		return avx2_kernels;
+	}
+	if (level != SimdLevel::scalar) {
+		return sse2_kernels;
+	}
+#endif
+	return scalar_kernels;
+}
+
+auto scan_kernels() -> const ScanKernels& {
+	static const ScanKernels& best = scan_kernels(SimdLevel::avx2);
+	return best;
+}
+
+}  // namespace lox
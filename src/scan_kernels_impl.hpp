@@ -0,0 +1,72 @@
+// Vectorized scan kernels shared by every instruction set.
+// Deliberately without include guard: scan_kernels.cpp includes it once per instruction set,
+// inside a namespace that provides width, mask_t, load(), eq() and in_range(),
+// and under a target pragma so the intrinsics inline.
+
+inline auto skip_whitespace(const char* first, const char* last, unsigned int& newlines) -> const char* {
+	while (last - first >= width) {
+		auto block      = load(first);
+		mask_t newline  = eq(block, '\n');
+		mask_t space    = newline | eq(block, ' ') | eq(block, '\t') | eq(block, '\r');
+		mask_t stop     = ~space & full_mask;
+		if (stop != 0) {
+			auto offset = std::countr_zero(stop);
+			newlines += static_cast<unsigned int>(std::popcount(newline & ((mask_t{1} << offset) - 1)));
+			return first + offset;
+		}
+		newlines += static_cast<unsigned int>(std::popcount(newline));
+		first += width;
+	}
+	return scalar::skip_whitespace(first, last, newlines);
+}
+
+inline auto find_newline(const char* first, const char* last) -> const char* {
+	while (last - first >= width) {
+		mask_t found = eq(load(first), '\n');
+		if (found != 0) {
+			return first + std::countr_zero(found);
+		}
+		first += width;
+	}
+	return scalar::find_newline(first, last);
+}
+
+inline auto find_quote(const char* first, const char* last, unsigned int& newlines) -> const char* {
+	while (last - first >= width) {
+		auto block     = load(first);
+		mask_t newline = eq(block, '\n');
+		mask_t quote   = eq(block, '"');
+		if (quote != 0) {
+			auto offset = std::countr_zero(quote);
+			newlines += static_cast<unsigned int>(std::popcount(newline & ((mask_t{1} << offset) - 1)));
+			return first + offset;
+		}
+		newlines += static_cast<unsigned int>(std::popcount(newline));
+		first += width;
+	}
+	return scalar::find_quote(first, last, newlines);
+}
+
+inline auto span_identifier(const char* first, const char* last) -> const char* {
+	while (last - first >= width) {
+		auto block      = load(first);
+		mask_t word     = in_range(lower(block), 'a', 'z') | in_range(block, '0', '9') | eq(block, '_');
+		mask_t stop     = ~word & full_mask;
+		if (stop != 0) {
+			return first + std::countr_zero(stop);
+		}
+		first += width;
+	}
+	return scalar::span_identifier(first, last);
+}
+
+inline auto span_digits(const char* first, const char* last) -> const char* {
+	while (last - first >= width) {
+		mask_t stop = ~in_range(load(first), '0', '9') & full_mask;
+		if (stop != 0) {
+			return first + std::countr_zero(stop);
+		}
+		first += width;
+	}
+	return scalar::span_digits(first, last);
+}
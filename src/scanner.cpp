@@ -1,20 +1,37 @@
 #include "lox/scanner.hpp"
 
-#include <iostream>
 #include <string_view>
 #include <vector>
 
+#include <lox/diagnostics.hpp>
+#include <lox/instrument.hpp>
 #include <lox/tokens.hpp>
 
 namespace lox {
 
 auto Scanner::scan_tokens() -> std::vector<Token> {
+	LOX_INSTRUMENT_SCOPE("scanner", "scan_tokens");
+	std::vector<Token> tokens;
+	do {
+		tokens.push_back(next_token());
+	} while (tokens.back().get_type() != TokenType::eof_tok);
+	return tokens;
+}
+
+auto Scanner::next_token() -> Token {
 	while (!is_at_end()) {
 		start_ = current_;
 		scan_token();
+		if (pending_) {
+			Token token = *pending_;
+			pending_.reset();
+			LOX_INSTRUMENT_COUNT(tokens, 1);
+			return token;
+		}
 	}
-	add_token(TokenType::eof_tok, "", {});
-	return tokens_;
+	// The empty lexeme sits at the end of the source so diagnostics can locate it
+	LOX_INSTRUMENT_COUNT(tokens, 1);
+	return Token(TokenType::eof_tok, source_.substr(source_.size()), line_);
 }
 
 auto Scanner::scan_token() -> void {
@@ -64,10 +81,8 @@ auto Scanner::scan_token() -> void {
 			break;
 		case '/':
 			if (match('/')) {
-				// comment until the tne of line
-				while (peek() != '\n' && !is_at_end()) {
-					advance();
-				}
+				// comment until the end of line
+				seek(kernels_->find_newline(cursor(), source_end()));
 			} else {
 				add_token(TokenType::slash_tok);
 			}
@@ -77,9 +92,9 @@ auto Scanner::scan_token() -> void {
 		case '\r':
 			[[fallthrough]];
 		case '\t':
-			break;
+			[[fallthrough]];
 		case '\n':
-			line_++;
+			skip_whitespace();
 			break;
 		case '"':
 			handle_string();
@@ -92,64 +107,47 @@ auto Scanner::scan_token() -> void {
 				handle_identifier();
 				break;
 			}
-			throw "Unexpected character";
+			error(DiagnosticCode::unexpected_character, "unexpected character.");
 			break;
 	}
 }
 
 auto Scanner::handle_identifier() -> void {
-	while (is_alpha_numeric(peek())) {
-		advance();
-	}
+	seek(kernels_->span_identifier(cursor(), source_end()));
 
 	auto text = source_.substr(start_, current_ - start_);
-	// see if any keywords
-	auto iter = keywords.find(text);
-	auto type = TokenType::identifier_tok;
-	if (iter != keywords.end()) {
-		type = iter->second;
-	}
-	add_token(type);
+	add_token(keyword_type(text));
 }
 
 auto Scanner::handle_number() -> void {
-	while (is_digit(peek())) {
-		advance();
-	}
+	seek(kernels_->span_digits(cursor(), source_end()));
 	if (peek() == '.' && is_digit(peek_next())) {
 		advance();
-		while (is_digit(peek())) {
-			advance();
-		}
+		seek(kernels_->span_digits(cursor(), source_end()));
 	}
 
-	auto text = source_.substr(start_, current_ - start_);
-	// We just do all numbers to double which is simpler
-	add_token(TokenType::number_tok, text, std::stod(text.data()));
+	// The value is decoded from the lexeme by Token::get_literal
+	add_token(TokenType::number_tok);
 }
 
 auto Scanner::handle_string() -> void {
-	while (peek() != '"' && !is_at_end()) {
-		if (peek() == '\n') {
-			line_++;
-		}
-		advance();
-	}
+	seek(kernels_->find_quote(cursor(), source_end(), line_));
 
-	// Unterminated string.
 	if (is_at_end()) {
-		std::cout << "Unterminated string" << std::endl;
+		error(DiagnosticCode::unterminated_string, "unterminated string.");
 		return;
 	}
 
 	// The closing ".
 	advance();
 
-	// Trim the surrounding quotes.
-	std::string_view value        = source_.substr(start_ + 1, current_ - start_ - 2);
-	std::string_view with_quoutes = source_.substr(start_, current_ - start_);
-	std::cout << " the string " << value << std::endl;
-	add_token(TokenType::string_tok, with_quoutes, value);
+	// The lexeme keeps its quotes, Token::get_literal trims them
+	add_token(TokenType::string_tok);
+}
+
+// Skips the whole whitespace run starting at the character just consumed
+auto Scanner::skip_whitespace() -> void {
+	seek(kernels_->skip_whitespace(source_.data() + start_, source_end(), line_));
 }
 
 auto Scanner::match(char expected) -> bool {
@@ -168,7 +166,7 @@ auto Scanner::peek_next() -> char {
 	if (current_ + 1 >= source_.size()) {
 		return '\0';
 	}
-	return source_.at(current_ + 1);
+	return source_[current_ + 1];
 }
 
 auto Scanner::peek() -> char {
@@ -178,18 +176,13 @@ auto Scanner::peek() -> char {
 	return source_[current_];
 }
 
-auto Scanner::add_token(TokenType type, LiteralType literal) -> void {
-	std::string_view text = source_.substr(start_, current_);
-	add_token(type, text, literal);
-}
-
 auto Scanner::add_token(TokenType type) -> void {
-	auto lexeme = source_.substr(start_, current_ - start_);
-	add_token(type, lexeme, lexeme);
+	pending_.emplace(type, source_.substr(start_, current_ - start_), line_);
 }
 
-auto Scanner::add_token(TokenType type, std::string_view lexeme, LiteralType literal) -> void {
-	tokens_.push_back(Token(type, lexeme, literal, line_));
+// Reports the text scanned since start_, no token is produced for it
+auto Scanner::error(DiagnosticCode code, std::string_view message) -> void {
+	diagnostics_.report(code, source_.substr(start_, current_ - start_), line_, message);
 }
 
 auto Scanner::is_digit(char c) -> bool { return c >= '0' && c <= '9'; }
@@ -0,0 +1,225 @@
+#include "lox/scanner.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <lox/instrument.hpp>
+#include <lox/tokens.hpp>
+
+namespace lox {
+
+namespace {
+
+// Below this a single thread wins, handing chunks to workers costs more than scanning
+constexpr std::size_t min_parallel_size = 256 * 1024;
+
+// Characters Scanner::skip_whitespace() consumes
+auto is_blank(char c) -> bool {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Threads kept for every parallel scan of the process, a scan hands them its chunks instead of starting
+// threads of its own. The pool grows to the most workers a scan asked for and stops when the process exits.
+// Scans running at the same time share the workers, each caller also works on its own chunks so a scan
+// finishes even while every worker is busy with another one.
+class WorkerPool {
+private:
+	// Indices [0, count) of one call to run(), handed out in order
+	struct Job {
+		void (*call)(const void* work, std::size_t index);
+		const void* work;
+		std::size_t count;
+		std::size_t next     = 0;
+		std::size_t finished = 0;
+	};
+
+	std::mutex mutex_;
+	std::condition_variable queued_;
+	std::condition_variable finished_;
+	// Jobs with indices left to hand out
+	std::deque<Job*> jobs_;
+	bool stopping_ = false;
+	std::vector<std::jthread> threads_;
+
+	// Takes the next index of job, dropping the job from the queue with its last index. Requires mutex_
+	auto take(Job& job) -> std::size_t {
+		auto index = job.next++;
+		if (job.next == job.count) {
+			jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+		}
+		return index;
+	}
+
+	auto finish(Job& job) -> void {
+		std::lock_guard lock{mutex_};
+		if (++job.finished == job.count) {
+			finished_.notify_all();
+		}
+	}
+
+	auto work() -> void {
+		std::unique_lock lock{mutex_};
+		while (true) {
+			queued_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+			if (stopping_) {
+				return;
+			}
+			auto& job  = *jobs_.front();
+			auto index = take(job);
+			lock.unlock();
+			job.call(job.work, index);
+			finish(job);
+			lock.lock();
+		}
+	}
+
+public:
+	WorkerPool() = default;
+	WorkerPool(const WorkerPool&)                    = delete;
+	auto operator=(const WorkerPool&) -> WorkerPool& = delete;
+
+	~WorkerPool() {
+		{
+			std::lock_guard lock{mutex_};
+			stopping_ = true;
+		}
+		queued_.notify_all();
+	}
+
+	// Calls work(i) for every i in [0, count) on up to workers pool threads and this one, returns when all are done
+	template <typename Work>
+	auto run(std::size_t count, std::size_t workers, const Work& work) -> void {
+		Job job{[](const void* w, std::size_t index) { (*static_cast<const Work*>(w))(index); }, &work, count};
+		std::unique_lock lock{mutex_};
+		while (threads_.size() < workers) {
+			threads_.emplace_back([this] { this->work(); });
+		}
+		jobs_.push_back(&job);
+		queued_.notify_all();
+		while (job.next < job.count) {
+			auto index = take(job);
+			lock.unlock();
+			work(index);
+			finish(job);
+			lock.lock();
+		}
+		finished_.wait(lock, [&] { return job.finished == job.count; });
+	}
+};
+
+auto worker_pool() -> WorkerPool& {
+	static WorkerPool pool;
+	return pool;
+}
+
+}  // namespace
+
+auto Scanner::scan_range(unsigned int begin, unsigned int end, unsigned int line) const -> RangeResult {
+	LOX_INSTRUMENT_SCOPE("scanner", "scan_range");
+	Scanner scanner{source_, *kernels_};
+	scanner.current_ = begin;
+	scanner.line_    = line;
+
+	RangeResult result;
+	while (scanner.current_ < end && !scanner.is_at_end()) {
+		scanner.start_ = scanner.current_;
+		scanner.scan_token();
+		if (scanner.pending_) {
+			result.tokens.push_back(*scanner.pending_);
+			scanner.pending_.reset();
+		}
+	}
+	// A range starting inside a multi line string scans garbage and may hit an error,
+	// that is only a failed guess which stitching repairs by rescanning
+	result.failed = scanner.diagnostics_.has_errors();
+	result.stop   = scanner.current_;
+	result.line = scanner.line_;
+	return result;
+}
+
+// Every chunk is scanned speculatively from the first non-blank character of a line as if no token was open there.
+// Newlines can only be inside strings, so a guess is right unless a string crosses into the chunk.
+// Stitching walks the chunks in order: when the previous chunk stopped exactly at this chunk's start
+// the guess is confirmed, otherwise the chunk is rescanned from where the previous one really stopped.
+auto Scanner::scan_tokens_parallel(unsigned int threads) -> std::vector<Token> {
+	rescanned_chunks_ = 0;
+	if (threads <= 1 || source_.size() < min_parallel_size) {
+		return scan_tokens();
+	}
+	LOX_INSTRUMENT_SCOPE("scanner", "scan_tokens_parallel");
+
+	// Chunk boundaries sit after a newline and the indentation and blank lines following it, exactly where
+	// the previous chunk's whitespace skip stops
+	std::vector<unsigned int> bounds{0};
+	auto size = static_cast<unsigned int>(source_.size());
+	for (unsigned int i = 1; i < threads; i++) {
+		auto target = std::max(bounds.back(), static_cast<unsigned int>(std::size_t{size} * i / threads));
+		const auto* newline =
+		    static_cast<const char*>(std::memchr(source_.data() + target, '\n', size - target));
+		if (newline == nullptr) {
+			break;
+		}
+		auto bound = static_cast<unsigned int>(newline - source_.data()) + 1;
+		while (bound < size && is_blank(source_[bound])) {
+			bound++;
+		}
+		if (bound > bounds.back() && bound < size) {
+			bounds.push_back(bound);
+		}
+	}
+	bounds.push_back(size);
+	auto chunks = bounds.size() - 1;
+
+	// Lines are relative to the chunk start until stitching knows the real line
+	std::vector<RangeResult> results(chunks);
+	auto& pool = worker_pool();
+	pool.run(chunks, chunks - 1, [&](std::size_t i) { results[i] = scan_range(bounds[i], bounds[i + 1], 0); });
+
+	// Decide which guesses hold, only the rare rescans run on this thread.
+	// base_lines[i] is added to chunk i's lines, rescanned chunks already carry real lines.
+	std::vector<unsigned int> base_lines(chunks, 0);
+	std::vector<std::size_t> offsets(chunks + 1, 0);
+	unsigned int position = 0;
+	unsigned int line     = 0;
+	for (std::size_t i = 0; i < chunks; i++) {
+		auto& chunk = results[i];
+		if (chunk.failed || position != bounds[i]) {
+			rescanned_chunks_++;
+			chunk.tokens.clear();
+			if (position < bounds[i + 1]) {
+				chunk = scan_range(position, bounds[i + 1], line);
+				if (chunk.failed) {
+					// A real error, rescan sequentially so it surfaces exactly like scan_tokens() reports it
+					return scan_tokens();
+				}
+				position = chunk.stop;
+				line     = chunk.line;
+			}
+			// else a token of an earlier chunk swallowed this whole chunk
+		} else {
+			base_lines[i] = line;
+			position      = chunk.stop;
+			line          = chunk.line + base_lines[i];
+		}
+		offsets[i + 1] = offsets[i] + chunk.tokens.size();
+	}
+
+	// Concatenate in parallel, each chunk lands at its precomputed offset
+	std::vector<Token> tokens(offsets.back() + 1, Token(TokenType::eof_tok, source_.substr(source_.size()), line));
+	pool.run(chunks, chunks - 1, [&](std::size_t i) {
+		auto* out = tokens.data() + offsets[i];
+		for (const auto& token : results[i].tokens) {
+			*out++ = Token(token.get_type(), token.get_lexeme(), token.get_line() + base_lines[i]);
+		}
+	});
+	LOX_INSTRUMENT_COUNT(tokens, tokens.size());
+	return tokens;
+}
+
+}  // namespace lox
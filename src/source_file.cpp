@@ -0,0 +1,127 @@
+#include "lox/source_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lox/lox.hpp>
+
+namespace lox {
+
+namespace {
+
+auto system_error(const std::string& what) -> LoxException { return LoxException(what + ": " + std::strerror(errno)); }
+
+// Closes the descriptor on every exit path, a mapping stays valid after close
+struct FileDescriptor {
+	int fd;
+	~FileDescriptor() {
+		if (fd >= 0) {
+			::close(fd);
+		}
+	}
+};
+
+}  // namespace
+
+SourceFile::SourceFile(SourceFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, false)),
+      buffer_(std::move(other.buffer_)) {
+	if (!mapped_) {
+		data_ = buffer_.data();
+	}
+}
+
+auto SourceFile::operator=(SourceFile&& other) noexcept -> SourceFile& {
+	if (this != &other) {
+		release();
+		data_   = std::exchange(other.data_, nullptr);
+		size_   = std::exchange(other.size_, 0);
+		mapped_ = std::exchange(other.mapped_, false);
+		buffer_ = std::move(other.buffer_);
+		if (!mapped_) {
+			data_ = buffer_.data();
+		}
+	}
+	return *this;
+}
+
+auto SourceFile::release() -> void {
+	if (mapped_) {
+		::munmap(const_cast<char*>(data_), size_);
+	}
+	data_   = nullptr;
+	size_   = 0;
+	mapped_ = false;
+	buffer_.clear();
+}
+
+auto SourceFile::open(const std::filesystem::path& path) -> SourceFile {
+	if (path == "-") {
+		return read(STDIN_FILENO);
+	}
+
+	FileDescriptor file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+	if (file.fd < 0) {
+		throw system_error("Can't open " + path.string());
+	}
+
+	struct stat info {};
+	if (::fstat(file.fd, &info) != 0) {
+		throw system_error("Can't stat " + path.string());
+	}
+	// Empty files can't be mapped and pipes or devices have no size to map
+	if (!S_ISREG(info.st_mode) || info.st_size == 0) {
+		return read(file.fd);
+	}
+
+	auto size     = static_cast<std::size_t>(info.st_size);
+	void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+	if (mapping == MAP_FAILED) {
+		return read(file.fd);
+	}
+	// The scanner walks the file front to back exactly once
+	::madvise(mapping, size, MADV_SEQUENTIAL);
+
+	SourceFile source;
+	source.data_   = static_cast<const char*>(mapping);
+	source.size_   = size;
+	source.mapped_ = true;
+	return source;
+}
+
+auto SourceFile::read(int fd) -> SourceFile {
+	constexpr std::size_t chunk = 64 * 1024;
+
+	SourceFile source;
+	std::size_t used = 0;
+	for (;;) {
+		source.buffer_.resize(used + chunk);
+		auto count = ::read(fd, source.buffer_.data() + used, chunk);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw system_error("Can't read source");
+		}
+		if (count == 0) {
+			break;
+		}
+		used += static_cast<std::size_t>(count);
+	}
+	source.buffer_.resize(used);
+	source.data_ = source.buffer_.data();
+	source.size_ = used;
+	return source;
+}
+
+}  // namespace lox
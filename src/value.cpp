@@ -0,0 +1,97 @@
+#include "lox/value.hpp"
+
+#include <charconv>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include <lox/object.hpp>
+#include <lox/tokens.hpp>
+
+namespace lox {
+
+namespace {
+
+auto number_to_string(double number) -> std::string {
+	// Shortest round trip form, integral numbers print without a fraction
+	char buffer[32];
+	auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), number);
+	return {buffer, end};
+}
+
+}  // namespace
+
+auto to_value(const LiteralType& literal, Heap& heap) -> Value {
+	return std::visit(visit_overloader{[](std::monostate) { return Value::nil(); },
+	                                   [](double number) { return Value{number}; },
+	                                   [](bool boolean) { return Value{boolean}; },
+	                                   [&](std::string_view text) { return Value{heap.intern(text)}; }},
+	                  literal);
+}
+
+auto to_value(const EvalResult& result, Heap& heap) -> Value {
+	return std::visit(visit_overloader{[](std::monostate) { return Value::nil(); },
+	                                   [](double number) { return Value{number}; },
+	                                   [](bool boolean) { return Value{boolean}; },
+	                                   [&](const std::string& text) { return Value{heap.intern(text)}; }},
+	                  result);
+}
+
+auto to_literal(Value value) -> LiteralType {
+	if (value.is_number()) {
+		return value.as_number();
+	}
+	if (value.is_bool()) {
+		return value.as_bool();
+	}
+	if (value.is_string()) {
+		return std::string_view{value.as_string()->chars};
+	}
+	return std::monostate{};
+}
+
+auto to_eval_result(Value value) -> EvalResult {
+	if (value.is_number()) {
+		return value.as_number();
+	}
+	if (value.is_bool()) {
+		return value.as_bool();
+	}
+	if (value.is_string()) {
+		return value.as_string()->chars;
+	}
+	if (value.is_obj()) {
+		return stringify(value);
+	}
+	return std::monostate{};
+}
+
+auto stringify(Value value) -> std::string {
+	if (value.is_number()) {
+		return number_to_string(value.as_number());
+	}
+	if (value.is_bool()) {
+		return value.as_bool() ? "true" : "false";
+	}
+	if (value.is_string()) {
+		return value.as_string()->chars;
+	}
+	if (value.is_class()) {
+		return value.as_class()->name->chars;
+	}
+	if (value.is_instance()) {
+		return value.as_instance()->klass->name->chars + " instance";
+	}
+	return "nil";
+}
+
+auto stringify(const EvalResult& value) -> std::string {
+	return std::visit(visit_overloader{[](std::monostate) -> std::string { return "nil"; },
+	                                   [](bool b) -> std::string { return b ? "true" : "false"; },
+	                                   [](double number) -> std::string { return number_to_string(number); },
+	                                   [](const std::string& text) -> std::string { return text; }},
+	                  value);
+}
+
+}  // namespace lox
@@ -0,0 +1,421 @@
+#include "lox/vm.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+#include <lox/chunk.hpp>
+#include <lox/instrument.hpp>
+#include <lox/lox.hpp>
+#include <lox/tokens.hpp>
+#include <lox/value.hpp>
+
+// For the dispatch loop's helper lambdas: a partially inlined helper hands its cold part a reference
+// to the closure, which pins ip and top in memory for the whole loop
+#if defined(__GNUC__)
+#define LOX_ALWAYS_INLINE __attribute__((always_inline))
+#else
+#define LOX_ALWAYS_INLINE
+#endif
+
+namespace lox {
+
+namespace {
+
+// Runtime errors are raised out of line, ip is passed by value so the dispatch loop can keep it in a register
+[[noreturn]] auto fail(const Chunk& chunk, const std::uint8_t* ip, std::string_view message) -> void {
+	auto offset = static_cast<std::size_t>(ip - chunk.code.data() - 1);
+	throw LoxException("[line " + std::to_string(chunk.lines[offset]) + "] " + std::string{message});
+}
+
+// Slow path of add, the operands must stay rooted while the result is allocated
+auto concatenate(Heap& heap, Value a, Value b, const Chunk& chunk, const std::uint8_t* ip) -> Value {
+	if (!a.is_string() || !b.is_string()) {
+		fail(chunk, ip, "Operands must be two numbers or two strings.");
+	}
+	return heap.make_string(a.as_string()->chars + b.as_string()->chars);
+}
+
+}  // namespace
+
+VM::VM(std::ostream& out, GcConfig gc, JitConfig jit)
+    : heap_(gc), stack_(stack_max), jit_config_(jit), out_(&out), stack_top_(stack_.data()) {
+	heap_.set_root_marker([this](Heap& heap) { mark_roots(heap); });
+}
+
+auto VM::mark_roots(Heap& heap) -> void {
+	for (const Value* slot = stack_.data(); slot != stack_top_; ++slot) {
+		heap.mark(*slot);
+	}
+	for (auto constant : constants_) {
+		heap.mark(constant);
+	}
+	// Every store into globals goes through the write barrier, scanning them once per cycle is enough
+	if (heap.remarking()) {
+		return;
+	}
+	for (auto [name, value] : globals_) {
+		heap.mark(name);
+		heap.mark(value);
+	}
+}
+
+auto VM::tier_up(JitRegion& region, const std::uint8_t* code, std::size_t length) -> void {
+	auto native = jit_compile({code, length}, constants_, global_slots_);
+	if (!native) {
+		jit_stats_.rejected++;
+		return;
+	}
+	jit_stats_.compiled++;
+	region.code  = std::move(*native);
+	region.entry = region.code.entry();
+}
+
+auto VM::guard_failed(JitRegion& region) -> void {
+	jit_stats_.guard_failures++;
+	// A region keeps seeing other types, its execution count is past the threshold so it is never compiled again
+	if (++region.guard_failures == jit_config_.max_guard_failures) {
+		jit_stats_.deoptimized++;
+		region.entry = nullptr;
+		region.code  = JitCode{};
+	}
+}
+
+auto VM::reset() -> void {
+	globals_.clear();
+	global_slots_.clear();
+	constants_.clear();
+	inline_caches_.clear();
+	jit_regions_.clear();
+	heap_.collect();
+}
+
+auto VM::run(const Chunk& chunk) -> EvalResult {
+	LOX_INSTRUMENT_SCOPE("vm", "run");
+	stack_top_ = stack_.data();
+	constants_.clear();
+	for (const auto& constant : chunk.constants) {
+		constants_.push_back(to_value(constant, heap_));
+	}
+
+	global_slots_.clear();
+	for (auto name : chunk.globals) {
+		// Slots a run doesn't define stay empty until some later run defines them
+		auto* key = constants_[name].as_string();
+		heap_.write_barrier(key);
+		global_slots_.push_back(&globals_.try_emplace(key, Value::empty()).first->second);
+	}
+
+	inline_caches_.assign(chunk.inline_caches, PropertyCache{});
+	jit_regions_.clear();
+	jit_regions_.resize(chunk.jit_regions);
+
+	const std::uint8_t* ip = chunk.code.data();
+	const Value* constants = constants_.data();
+	Value* base            = stack_.data();
+	Value* top             = base;
+	Value* limit           = base + stack_.size();
+
+	auto push = [&](Value value) LOX_ALWAYS_INLINE {
+		if (top == limit) [[unlikely]] {
+			fail(chunk, ip, "Stack overflow.");
+		}
+		*top++ = value;
+	};
+	auto pop       = [&]() -> Value { return *--top; };
+	auto read_u16  = [&]() -> std::uint16_t {
+		ip += 2;
+		return static_cast<std::uint16_t>((ip[-2] << 8) | ip[-1]);
+	};
+	auto name      = [&](std::uint16_t constant) -> ObjString* { return constants[constant].as_string(); };
+	// Checks both operands are numbers and pops them, the result is pushed by the caller
+	auto numbers   = [&]() LOX_ALWAYS_INLINE -> std::pair<double, double> {
+		if (!top[-2].is_number() || !top[-1].is_number()) [[unlikely]] {
+			fail(chunk, ip, "Operands must be numbers.");
+		}
+		top -= 2;
+		return {top[0].as_number(), top[1].as_number()};
+	};
+	// Same for a stack operand compared to a constant, the stack operand is left for the result to replace
+	auto number_and_constant = [&]() LOX_ALWAYS_INLINE -> std::pair<double, double> {
+		Value b = constants[read_u16()];
+		if (!top[-1].is_number() || !b.is_number()) [[unlikely]] {
+			fail(chunk, ip, "Operands must be numbers.");
+		}
+		return {top[-1].as_number(), b.as_number()};
+	};
+	// Operands must stay rooted, on the stack or in the constants, while a concatenation allocates
+	auto add = [&](Value a, Value b) LOX_ALWAYS_INLINE -> Value {
+		if (a.is_number() && b.is_number()) [[likely]] {
+			return a.as_number() + b.as_number();
+		}
+		stack_top_ = top;
+		return concatenate(heap_, a, b, chunk, ip);
+	};
+
+#ifdef LOX_COMPUTED_GOTO
+	// Threaded dispatch: every handler jumps straight to the next one, giving each its own indirect branch.
+	// One label per OpCode in declaration order
+	static const void* const handlers[] = {
+		&&constant_op, &&nil_op, &&true_op, &&false_op, &&pop_op, &&get_local_op, &&set_local_op, &&get_global_op,
+		&&define_global_op, &&set_global_op, &&get_property_op, &&set_property_op, &&equal_op, &&greater_op,
+		&&less_op, &&add_op, &&subtract_op, &&multiply_op, &&divide_op, &&not_op, &&negate_op, &&print_op, &&jump_op,
+		&&jump_if_false_op, &&loop_op, &&call_op, &&class_op, &&add_local_op, &&add_constant_op, &&equal_constant_op,
+		&&greater_constant_op, &&less_constant_op, &&pop_jump_if_false_op, &&jit_region_op, &&return_op
+	};
+	static_assert(std::size(handlers) == opcode_count, "every opcode needs a handler");
+#define LOX_CASE(op) op
+#define LOX_NEXT() goto* handlers[*ip++]
+	LOX_NEXT();
+	{
+#else
+#define LOX_CASE(op) case OpCode::op
+#define LOX_NEXT() continue
+	for (;;) {
+		switch (static_cast<OpCode>(*ip++)) {
+#endif
+			LOX_CASE(constant_op):
+				push(constants[read_u16()]);
+				LOX_NEXT();
+			LOX_CASE(nil_op):
+				push(Value::nil());
+				LOX_NEXT();
+			LOX_CASE(true_op):
+				push(true);
+				LOX_NEXT();
+			LOX_CASE(false_op):
+				push(false);
+				LOX_NEXT();
+			LOX_CASE(pop_op):
+				--top;
+				LOX_NEXT();
+			LOX_CASE(get_local_op):
+				push(base[*ip++]);
+				LOX_NEXT();
+			LOX_CASE(set_local_op):
+				base[*ip++] = top[-1];
+				LOX_NEXT();
+			LOX_CASE(get_global_op): {
+				auto slot    = read_u16();
+				Value global = *global_slots_[slot];
+				if (global.is_empty()) [[unlikely]] {
+					fail(chunk, ip, "Undefined variable '" + name(chunk.globals[slot])->chars + "'.");
+				}
+				push(global);
+				LOX_NEXT();
+			}
+			LOX_CASE(define_global_op):
+				heap_.write_barrier(top[-1]);
+				*global_slots_[read_u16()] = pop();
+				LOX_NEXT();
+			LOX_CASE(set_global_op): {
+				auto slot     = read_u16();
+				Value& global = *global_slots_[slot];
+				if (global.is_empty()) [[unlikely]] {
+					fail(chunk, ip, "Undefined variable '" + name(chunk.globals[slot])->chars + "'.");
+				}
+				heap_.write_barrier(top[-1]);
+				global = top[-1];
+				LOX_NEXT();
+			}
+			LOX_CASE(get_property_op): {
+				auto constant = read_u16();
+				auto& cache   = inline_caches_[read_u16()];
+				if (!top[-1].is_instance()) [[unlikely]] {
+					fail(chunk, ip, "Only instances have properties.");
+				}
+				auto* instance = top[-1].as_instance();
+				if (const auto* entry = cache.lookup(instance->shape)) [[likely]] {
+					(entry == cache.entries.data() ? ic_stats_.monomorphic_hits : ic_stats_.polymorphic_hits)++;
+					top[-1] = instance->fields[entry->slot];
+					LOX_NEXT();
+				}
+				auto slot = instance->shape->find(name(constant));
+				if (slot < 0) [[unlikely]] {
+					fail(chunk, ip, "Undefined property '" + name(constant)->chars + "'.");
+				}
+				(cache.full() ? ic_stats_.megamorphic_misses : ic_stats_.misses)++;
+				cache.add({instance->shape, instance->shape, static_cast<std::uint32_t>(slot)});
+				top[-1] = instance->fields[slot];
+				LOX_NEXT();
+			}
+			LOX_CASE(set_property_op): {
+				auto constant = read_u16();
+				auto& cache   = inline_caches_[read_u16()];
+				if (!top[-2].is_instance()) [[unlikely]] {
+					fail(chunk, ip, "Only instances have fields.");
+				}
+				auto* instance = top[-2].as_instance();
+				Value value    = top[-1];
+				heap_.write_barrier(value);
+				PropertyCache::Entry missed;
+				const auto* entry = cache.lookup(instance->shape);
+				if (entry != nullptr) [[likely]] {
+					(entry == cache.entries.data() ? ic_stats_.monomorphic_hits : ic_stats_.polymorphic_hits)++;
+				} else {
+					// An existing field is overwritten in place, a new one moves the instance to the next shape
+					(cache.full() ? ic_stats_.megamorphic_misses : ic_stats_.misses)++;
+					auto* shape = instance->shape;
+					auto slot   = shape->find(name(constant));
+					missed      = slot >= 0 ? PropertyCache::Entry{shape, shape, static_cast<std::uint32_t>(slot)}
+					                        : PropertyCache::Entry{shape, heap_.transition(shape, name(constant)),
+					                                               static_cast<std::uint32_t>(shape->keys.size())};
+					cache.add(missed);
+					entry = &missed;
+				}
+				if (entry->next == instance->shape) {
+					instance->fields[entry->slot] = value;
+				} else {
+					heap_.add_field(instance, entry->next, value);
+				}
+				top[-2] = value;
+				--top;
+				LOX_NEXT();
+			}
+			LOX_CASE(equal_op): {
+				auto b = pop();
+				auto a = pop();
+				push(a == b);
+				LOX_NEXT();
+			}
+			LOX_CASE(greater_op): {
+				auto [a, b] = numbers();
+				push(a > b);
+				LOX_NEXT();
+			}
+			LOX_CASE(less_op): {
+				auto [a, b] = numbers();
+				push(a < b);
+				LOX_NEXT();
+			}
+			LOX_CASE(add_op):
+				top[-2] = add(top[-2], top[-1]);
+				--top;
+				LOX_NEXT();
+			LOX_CASE(subtract_op): {
+				auto [a, b] = numbers();
+				push(a - b);
+				LOX_NEXT();
+			}
+			LOX_CASE(multiply_op): {
+				auto [a, b] = numbers();
+				push(a * b);
+				LOX_NEXT();
+			}
+			LOX_CASE(divide_op): {
+				auto [a, b] = numbers();
+				push(a / b);
+				LOX_NEXT();
+			}
+			LOX_CASE(not_op):
+				top[-1] = top[-1].is_falsey();
+				LOX_NEXT();
+			LOX_CASE(negate_op): {
+				if (!top[-1].is_number()) [[unlikely]] {
+					fail(chunk, ip, "Operand must be a number.");
+				}
+				top[-1] = -top[-1].as_number();
+				LOX_NEXT();
+			}
+			LOX_CASE(print_op):
+				*out_ << stringify(pop()) << '\n';
+				LOX_NEXT();
+			LOX_CASE(jump_op): {
+				auto offset = read_u16();
+				ip += offset;
+				LOX_NEXT();
+			}
+			LOX_CASE(jump_if_false_op): {
+				auto offset = read_u16();
+				if (top[-1].is_falsey()) {
+					ip += offset;
+				}
+				LOX_NEXT();
+			}
+			LOX_CASE(loop_op): {
+				auto offset = read_u16();
+				ip -= offset;
+				LOX_NEXT();
+			}
+			LOX_CASE(call_op): {
+				auto count   = *ip++;
+				Value callee = top[-1 - count];
+				if (!callee.is_class()) [[unlikely]] {
+					fail(chunk, ip, "Can only call functions and classes.");
+				}
+				// Classes have no initializer yet
+				if (count != 0) [[unlikely]] {
+					fail(chunk, ip, "Expected 0 arguments but got " + std::to_string(count) + ".");
+				}
+				stack_top_ = top;
+				top[-1]    = heap_.make_instance(callee.as_class());
+				LOX_NEXT();
+			}
+			LOX_CASE(class_op): {
+				auto constant = read_u16();
+				stack_top_    = top;
+				push(heap_.make_class(name(constant)));
+				LOX_NEXT();
+			}
+			LOX_CASE(add_local_op):
+				top[-1] = add(top[-1], base[*ip++]);
+				LOX_NEXT();
+			LOX_CASE(add_constant_op):
+				top[-1] = add(top[-1], constants[read_u16()]);
+				LOX_NEXT();
+			LOX_CASE(equal_constant_op):
+				top[-1] = top[-1] == constants[read_u16()];
+				LOX_NEXT();
+			LOX_CASE(greater_constant_op): {
+				auto [a, b] = number_and_constant();
+				top[-1]     = a > b;
+				LOX_NEXT();
+			}
+			LOX_CASE(less_constant_op): {
+				auto [a, b] = number_and_constant();
+				top[-1]     = a < b;
+				LOX_NEXT();
+			}
+			LOX_CASE(pop_jump_if_false_op): {
+				auto offset = read_u16();
+				if ((--top)->is_falsey()) {
+					ip += offset;
+				}
+				LOX_NEXT();
+			}
+			LOX_CASE(jit_region_op): {
+				auto& region = jit_regions_[read_u16()];
+				auto length  = read_u16();
+				if (region.entry != nullptr) {
+					auto bits = region.entry(base);
+					if (bits != jit_guard_failed) [[likely]] {
+						jit_stats_.native_runs++;
+						push(Value::from_bits(bits));
+						ip += length;
+						LOX_NEXT();
+					}
+					guard_failed(region);
+				} else if (jit_config_.enabled && ++region.executions == jit_config_.hot_threshold) {
+					tier_up(region, ip, length);
+				}
+				// Interpret the region's code that follows
+				LOX_NEXT();
+			}
+			LOX_CASE(return_op):
+				// Nothing on the stack is a root anymore once the run is over
+				stack_top_ = base;
+				return to_eval_result(pop());
+#ifdef LOX_COMPUTED_GOTO
+	}
+#else
+		}
+	}
+#endif
+#undef LOX_CASE
+#undef LOX_NEXT
+}
+
+}  // namespace lox
@@ -0,0 +1,176 @@
+#include "test_support.hpp"
+
+#include <lox/chunk_cache.hpp>
+#include <lox/compiler.hpp>
+#include <lox/instrument.hpp>
+#include <lox/parser.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+   using test::check;
+
+   auto run(const lox::Chunk &chunk) -> std::string
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto result = vm.run(chunk);
+      return out.str() + lox::stringify(result);
+   }
+
+   auto same(const lox::Chunk &a, const lox::Chunk &b) -> bool
+   {
+      return a.code == b.code && a.lines == b.lines && a.constants == b.constants && a.globals == b.globals &&
+             a.inline_caches == b.inline_caches && a.jit_regions == b.jit_regions;
+   }
+}
+
+int main()
+{
+   const std::string script = "class P {} var p = P(); p.x = 1.5; var s = \"a\" + \"b\";\n"
+                              "{ var i = 0; while (i < 3) { print s; i = i + 1; } }\n"
+                              "var t = true; var n = nil; if (t) print 1; else print 2; p.x * 2;";
+
+   lox::Arena arena;
+   auto compiled = lox::Compiler{}.compile(*lox::parse_program(script, arena));
+
+   // Images round trip every constant kind and only match the source they were compiled from
+   {
+      auto image = lox::serialize(compiled, script);
+      auto loaded = lox::deserialize(image, script);
+      check(loaded.has_value() && same(*loaded, compiled), "image round trips");
+      check(!lox::deserialize(image, script + " ").has_value(), "another source misses");
+      check(!lox::deserialize(std::string_view{image}.substr(0, image.size() - 1), script).has_value(),
+            "truncated image misses");
+      auto other_version = image;
+      other_version[4] = static_cast<char>(other_version[4] + 1);
+      check(!lox::deserialize(other_version, script).has_value(), "another format version misses");
+   }
+
+   // Images whose header matches but whose code or globals point outside their tables miss
+   {
+      auto misses = [&](const lox::Chunk &damaged)
+      { return !lox::deserialize(lox::serialize(damaged, script), script).has_value(); };
+      // Offset of the first op in the code
+      auto find = [](const lox::Chunk &chunk, lox::OpCode op)
+      {
+         std::size_t pc = 0;
+         while (static_cast<lox::OpCode>(chunk.code[pc]) != op)
+         {
+            pc += 1 + lox::operand_size(static_cast<lox::OpCode>(chunk.code[pc]));
+         }
+         return pc;
+      };
+      auto number = std::find_if(compiled.constants.begin(), compiled.constants.end(),
+                                 [](const lox::EvalResult &c) { return std::holds_alternative<double>(c); });
+
+      auto damaged = compiled;
+      damaged.globals[0] = static_cast<std::uint16_t>(compiled.constants.size());
+      check(misses(damaged), "global name past the constants misses");
+      damaged = compiled;
+      damaged.globals[0] = static_cast<std::uint16_t>(number - compiled.constants.begin());
+      check(misses(damaged), "global name that is no string misses");
+      damaged = compiled;
+      damaged.code[find(compiled, lox::OpCode::constant_op) + 1] = 0xff;
+      check(misses(damaged), "constant index past the constants misses");
+      damaged = compiled;
+      damaged.code[find(compiled, lox::OpCode::get_global_op) + 2] = 0xff;
+      check(misses(damaged), "global slot past the globals misses");
+      damaged = compiled;
+      damaged.inline_caches = 0;
+      check(misses(damaged), "inline cache past the caches misses");
+      damaged = compiled;
+      damaged.code[find(compiled, lox::OpCode::jump_op) + 2]++;
+      check(misses(damaged), "jump into an instruction misses");
+      damaged = compiled;
+      damaged.code[find(compiled, lox::OpCode::loop_op) + 1] = 0xff;
+      check(misses(damaged), "loop before the code misses");
+      damaged = compiled;
+      damaged.code.back() = static_cast<std::uint8_t>(lox::OpCode::pop_op);
+      check(misses(damaged), "code without return misses");
+      damaged = compiled;
+      damaged.code.back() = static_cast<std::uint8_t>(lox::opcode_count);
+      check(misses(damaged), "unknown opcode misses");
+   }
+
+   check(lox::content_hash(script) == lox::content_hash(std::string{script}), "hash depends on content only");
+   check(lox::content_hash("abc") != lox::content_hash("abd"), "hash sees the last byte");
+   check(lox::content_hash("") != lox::content_hash(std::string_view{"\0", 1}), "hash sees the length");
+
+   auto directory = std::filesystem::temp_directory_path() / ("lox_chunk_cache_test_" + std::to_string(::getpid()));
+   {
+      lox::ChunkCache cache{directory / "nested"};
+      check(!cache.load(script).has_value(), "empty cache misses");
+
+      auto first = cache.compile(script);
+      check(first.has_value() && same(*first, compiled), "miss compiles");
+      check(std::filesystem::exists(cache.path_for(script)), "miss stores the entry");
+
+      // A hit never touches the Scanner or Parser
+      lox::instrument::reset();
+      auto second = cache.compile(script);
+      check(second.has_value() && run(*second) == run(compiled), "hit runs like the compiled chunk");
+      check(lox::instrument::counts().tokens == 0 && lox::instrument::counts().ast_nodes == 0, "hit skips parsing");
+
+      // An edited script gets its own entry
+      auto edited = script + " print 1;";
+      check(cache.path_for(edited) != cache.path_for(script), "edited script has another entry");
+      check(!cache.load(edited).has_value(), "edited script misses");
+
+      // Corrupt entries behave like misses and are replaced
+      std::ofstream(cache.path_for(script), std::ios::binary | std::ios::trunc) << "LOXC";
+      check(!cache.load(script).has_value(), "corrupt entry misses");
+      check(cache.compile(script).has_value() && cache.load(script).has_value(), "corrupt entry replaced");
+
+      // Threads storing the same script each write their own temporary file before renaming
+      {
+         std::vector<std::thread> workers;
+         std::atomic<int> stored{0};
+         for (int t = 0; t < 8; t++)
+         {
+            workers.emplace_back(
+                [&]
+                {
+                   for (int i = 0; i < 20; i++)
+                   {
+                      stored += cache.store(script, compiled) ? 1 : 0;
+                   }
+                });
+         }
+         for (auto &worker : workers)
+         {
+            worker.join();
+         }
+         auto loaded = cache.load(script);
+         check(stored == 160 && loaded.has_value() && same(*loaded, compiled), "concurrent stores all succeed");
+         auto leftovers = 0;
+         for (const auto &entry : std::filesystem::directory_iterator(directory / "nested"))
+         {
+            leftovers += entry.path().extension() == ".tmp" ? 1 : 0;
+         }
+         check(leftovers == 0, "no temporary files are left behind");
+      }
+
+      auto broken = cache.compile("var = 1;");
+      check(!broken.has_value() && broken.error().has_errors(), "syntax errors are returned");
+      check(!std::filesystem::exists(cache.path_for("var = 1;")), "broken scripts are not stored");
+   }
+   std::filesystem::remove_all(directory);
+
+   return test::finish("chunk cache");
+}
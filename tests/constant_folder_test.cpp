@@ -0,0 +1,108 @@
+#include <lox/arena.hpp>
+#include <lox/ast.hpp>
+#include <lox/compiler.hpp>
+#include <lox/constant_folder.hpp>
+#include <lox/lox.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+   int failures = 0;
+
+   // Result and printed output of a program, or the runtime error message
+   auto run(std::string_view code, bool folded, std::size_t &eliminated) -> std::string
+   {
+      lox::Arena arena;
+      lox::Scanner scanner{code};
+      std::vector<lox::Token> tokens = scanner.scan_tokens();
+      lox::Parser parser{tokens, arena};
+      auto program = parser.parse();
+
+      lox::ConstantFolder folder{arena};
+      if (folded)
+      {
+         folder.fold(program);
+      }
+      eliminated = folder.eliminated();
+
+      std::ostringstream out;
+      try
+      {
+         lox::VM vm{out};
+         auto result = vm.run(lox::Compiler{}.compile(program));
+         return out.str() + lox::stringify(result);
+      }
+      catch (LoxException &error)
+      {
+         return out.str() + "error: " + error.what();
+      }
+   }
+
+   // Folding must never change what a program does
+   void expect(std::string_view code, std::size_t expected_eliminated)
+   {
+      std::size_t none = 0;
+      std::size_t eliminated = 0;
+      auto plain = run(code, false, none);
+      auto folded = run(code, true, eliminated);
+      if (plain != folded || eliminated != expected_eliminated)
+      {
+         std::cout << "FAIL: " << code << "\n  plain:  " << plain << "\n  folded: " << folded
+                   << "\n  eliminated " << eliminated << " nodes (expected " << expected_eliminated << ")" << std::endl;
+         failures++;
+      }
+   }
+}
+
+int main()
+{
+   // A fully constant expression becomes a single literal
+   {
+      lox::Arena arena;
+      lox::Scanner scanner{"(2 * 3) + 4;"};
+      std::vector<lox::Token> tokens = scanner.scan_tokens();
+      lox::Parser parser{tokens, arena};
+      auto expressions = parser.parse_expression();
+      auto before = lox::count_nodes(expressions[0]);
+
+      lox::ConstantFolder folder{arena};
+      folder.fold(expressions[0]);
+      const auto *literal = std::get_if<lox::Box<lox::Literal>>(&expressions[0]);
+      if (before != 6 || literal == nullptr || (*literal)->value != lox::LiteralType(10.0) || folder.eliminated() != 5)
+      {
+         std::cout << "FAIL: (2 * 3) + 4 did not fold into 10" << std::endl;
+         failures++;
+      }
+   }
+
+   expect("(2 * 3) + 4;", 5);
+   expect("-(1 - 3) / 4 >= 0.5 == !nil;", 11);
+   expect("\"con\" + \"cat\" == \"concat\";", 4);
+   expect("1 == \"1\";", 2);
+   expect("0 / 0 != 0 / 0;", 6);
+   expect("var a = 2; a * (3 + 4);", 3);
+   expect("var a = 2; (a + 1) * 3;", 1);
+   // Short circuiting keeps the operand the VM would have produced
+   expect("nil and undefined_variable;", 2);
+   expect("\"left\" or undefined_variable;", 2);
+   expect("var a = 1; true and a;", 2);
+   expect("var a = 1; false or (a + 1);", 3);
+   expect("var a = nil; a or 1 + 1;", 2);
+   // Operations that fail at runtime are left alone
+   expect("-\"text\";", 0);
+   expect("1 + \"text\";", 0);
+   expect("(1 < \"2\");", 1);
+   expect("var sum = 0; for (var i = 0; i < 2 * 5; i = i + (1 + 0)) sum = sum + i; print sum;", 5);
+
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "test_support.hpp"
+
+#include <lox/object.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using test::check;
+using test::compile;
+
+int main()
+{
+   // Unrooted strings are reclaimed and dropped from the intern table, rooted ones survive
+   {
+      lox::Heap heap;
+      auto *kept = heap.make_string("kept");
+      heap.make_string("garbage");
+      heap.set_root_marker([&](lox::Heap &h) { h.mark(lox::Value{kept}); });
+      heap.collect();
+      check(heap.stats().collections == 1 && heap.stats().objects_freed == 1, "one unrooted string is freed");
+      check(heap.interned_count() == 1 && heap.intern("kept") == kept, "the rooted string stays interned");
+   }
+
+   // Collecting before every allocation must not free anything the VM still uses
+   {
+      std::ostringstream out;
+      lox::VM vm{out, lox::GcConfig{.stress = true}};
+      vm.run(compile("var greeting = \"hel\" + \"lo\"; var parts = \"a\";"));
+      auto result = vm.run(compile("{ var local = \"b\" + \"c\"; parts = parts + local + parts; }"
+                                   "print greeting + \" \" + parts; greeting + parts;"));
+      check(lox::stringify(result) == "helloabca" && out.str() == "hello abca\n", "stress collection keeps live strings");
+      check(vm.gc_stats().collections > 0, "stress mode collects");
+   }
+
+   // Repeated concatenation leaves one live string, memory stays bounded by the collector
+   {
+      lox::VM vm{std::cout, lox::GcConfig{.initial_heap_size = 64 * 1024, .growth_factor = 2.0}};
+      auto result = vm.run(compile("var s = \"\"; for (var i = 0; i < 4000; i = i + 1) s = s + \"x\"; s;"));
+      const auto &stats = vm.gc_stats();
+      check(lox::stringify(result) == std::string(4000, 'x'), "the final string is built");
+      check(stats.collections > 10, "allocation pressure triggers collections");
+      check(stats.bytes_allocated < 256 * 1024, "live bytes stay bounded");
+      check(stats.bytes_freed > 4 * 1024 * 1024, "dead strings are freed");
+      check(stats.max_pause >= stats.last_pause && stats.total_pause >= stats.max_pause, "pause times are recorded");
+
+      vm.collect_garbage();
+      check(vm.gc_stats().bytes_allocated < 16 * 1024, "only globals survive once the run is over");
+   }
+
+   // Incremental cycles interleave with the program, tiny steps stretch every cycle over many allocations
+   // so globals are reassigned and strings revived from the intern table while a cycle is running
+   {
+      std::size_t pauses = 0;
+      lox::GcConfig config{.mode = lox::GcMode::incremental,
+                           .initial_heap_size = 4 * 1024,
+                           .step_budget = 4,
+                           .on_pause = [&](std::chrono::nanoseconds) { pauses++; }};
+      std::ostringstream out;
+      lox::VM vm{out, config};
+      vm.run(compile("var keep = \"k\"; var s = \"\";"));
+      auto result = vm.run(compile("for (var i = 0; i < 3000; i = i + 1) {"
+                                   "  s = s + \"x\";"
+                                   "  var t = \"k\" + \"eep\";"
+                                   "  if (i == 1500) keep = keep + s;"
+                                   "}"
+                                   "keep;"));
+      const auto &stats = vm.gc_stats();
+      check(lox::stringify(result) == "k" + std::string(1501, 'x'), "globals written during marking survive");
+      check(stats.collections > 10 && stats.steps > 4 * stats.collections, "cycles are spread over many steps");
+      check(pauses == stats.steps, "every step reports its pause");
+      check(stats.bytes_allocated < 128 * 1024, "incremental mode keeps memory bounded");
+   }
+
+   // A class created before a cycle and reachable only through a field of an object still gray is
+   // instantiated and unlinked during marking. The new instance is black and then the only reference
+   // to the class, so making it must shade the class
+   {
+      lox::Heap heap{lox::GcConfig{.mode = lox::GcMode::incremental, .step_budget = 1}};
+      auto *field = heap.make_string("k");
+      auto *klass = heap.make_class(heap.make_string("C"));
+      auto *holder = heap.make_instance(heap.make_class(heap.make_string("O")));
+      auto *shape = heap.transition(heap.empty_shape(), field);
+      heap.add_field(holder, shape, lox::Value{klass});
+      std::vector<lox::Obj *> roots{holder};
+      for (int i = 0; i < 8; i++)
+      {
+         roots.push_back(heap.make_string("filler " + std::to_string(i)));
+      }
+      // Roots marked last are traced first, the holder stays gray for the next steps
+      heap.set_root_marker(
+          [&](lox::Heap &h)
+          {
+             for (auto *root : roots)
+             {
+                h.mark(root);
+             }
+          });
+      heap.step();
+      auto *instance = heap.make_instance(klass);
+      roots.push_back(instance);
+      holder->fields[0] = lox::Value{};
+      heap.collect();
+      check(heap.stats().objects_freed == 0, "a class only referenced by a new instance survives marking");
+   }
+
+   // The same through the VM: thirty globals are traced before the local o, the chain of instances
+   // makes a later cycle trace every instance and their classes
+   std::string globals;
+   for (int i = 0; i < 30; i++)
+   {
+      globals += "var g" + std::to_string(i) + " = \"g\" + \"" + std::to_string(i) + "\";";
+   }
+   for (std::size_t budget = 1; budget <= 8; budget++)
+   {
+      std::ostringstream out;
+      lox::VM vm{out, lox::GcConfig{.mode = lox::GcMode::incremental, .initial_heap_size = 1024, .step_budget = budget}};
+      vm.run(compile("class O {}" + globals + "var last = nil; var s = \"\";"
+                     "{ var o = O();"
+                     "  for (var m = 0; m < 100; m = m + 1) {"
+                     "    s = \"\";"
+                     "    for (var n = 0; n < 50; n = n + 1) {"
+                     "      { class C {} o.k = C; }"
+                     "      s = s + \"z\";"
+                     "      var i = o.k(); o.k = nil; i.prev = last; last = i;"
+                     "    }"
+                     "  }"
+                     "}"
+                     "{ var count = 0; while (last != nil) { count = count + 1; last = last.prev; } print count; }"));
+      check(out.str() == "5000\n", "classes only referenced by new instances survive");
+      check(vm.gc_stats().collections > 0, "instances are made during cycles");
+   }
+
+   return test::finish("gc");
+}
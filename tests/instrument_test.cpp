@@ -0,0 +1,78 @@
+#include "test_support.hpp"
+
+#include <lox/arena.hpp>
+#include <lox/compiler.hpp>
+#include <lox/instrument.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+#include <lox/vm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+   using test::check;
+
+   auto contains(const std::string &text, std::string_view part) -> bool
+   {
+      return text.find(part) != std::string::npos;
+   }
+}
+
+int main()
+{
+   namespace instrument = lox::instrument;
+   instrument::reset();
+
+   // 1 + 2 * 3; is 7 tokens with eof and 5 nodes: Binary(Literal, Binary(Literal, Literal))
+   {
+      lox::Scanner scanner{"1 + 2 * 3;"};
+      std::vector<lox::Token> tokens = scanner.scan_tokens();
+      lox::Arena arena;
+      lox::Parser parser{tokens, arena};
+      parser.parse_expression();
+   }
+   auto counts = instrument::counts();
+   if constexpr (instrument::enabled)
+   {
+      check(counts.tokens == 7, "tokens counted");
+      check(counts.ast_nodes == 5, "nodes counted");
+      check(counts.box_allocations == 5, "boxes counted");
+      check(counts.box_bytes > 0, "box bytes counted");
+      check(instrument::event_count() == 2, "scan and parse recorded");
+   }
+   else
+   {
+      check(counts.tokens == 0 && counts.ast_nodes == 0 && counts.box_allocations == 0, "nothing counted");
+      check(instrument::event_count() == 0, "nothing recorded");
+   }
+
+   // Streaming parses count tokens inside the parse phase, nested phases are recorded too
+   instrument::reset();
+   {
+      lox::Arena arena;
+      auto program = lox::parse_program("var a = 1; print a + 2;", arena);
+      std::ostringstream out;
+      lox::VM vm{out};
+      vm.run(lox::Compiler{}.compile(*program));
+   }
+   std::ostringstream trace;
+   instrument::write_chrome_trace(trace);
+   if constexpr (instrument::enabled)
+   {
+      check(instrument::counts().tokens == 11, "streamed tokens counted");
+      for (auto phase : {"\"parse_program\"", "\"parse\"", "\"resolve\"", "\"compile\"", "\"run\""})
+      {
+         check(contains(trace.str(), phase), phase);
+      }
+      check(contains(trace.str(), "\"ph\": \"X\""), "complete events");
+   }
+   check(contains(trace.str(), "\"traceEvents\": ["), "trace events array");
+   check(contains(trace.str(), "\"ph\": \"C\""), "counter event");
+
+   return test::finish("instrument");
+}
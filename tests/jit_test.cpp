@@ -0,0 +1,124 @@
+#include "test_support.hpp"
+
+#include <lox/jit.hpp>
+#include <lox/lox.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+   using test::check;
+   using test::compile;
+   using test::failures;
+
+   struct Run
+   {
+      std::string output;
+      lox::JitStats stats;
+   };
+
+   constexpr lox::JitConfig interpreter{.enabled = false};
+   constexpr lox::JitConfig eager{.enabled = true, .hot_threshold = 1, .max_guard_failures = 3};
+
+   // Output of the script, or the message of the error it raised.
+   // Regions are always marked, jit decides whether the VM runs them natively
+   auto run(std::string_view code, lox::JitConfig jit) -> Run
+   {
+      std::ostringstream out;
+      lox::VM vm{out, {}, jit};
+      try
+      {
+         out << lox::stringify(vm.run(compile(code, eager)));
+      }
+      catch (LoxException &e)
+      {
+         out << "error: " << e.what();
+      }
+      return {out.str(), vm.jit_stats()};
+   }
+
+   // Runs the expression over a range of x and y, natively once it is hot, and compares with the interpreter
+   void expect_same(std::string_view expression, bool native = true)
+   {
+      auto code = "var y = 0.5; for (var x = -3; x < 4; x = x + 0.5) { y = -y; print " + std::string{expression} +
+                  "; }";
+      auto expected = run(code, interpreter);
+      auto actual = run(code, eager);
+      if (actual.output != expected.output)
+      {
+         std::cout << "FAIL: " << expression << "\n  jit: " << actual.output
+                   << "\n  interpreter: " << expected.output << std::endl;
+         failures++;
+      }
+      check(expected.stats.compiled == 0, "disabled JIT compiles nothing");
+      if (lox::jit_supported() && native)
+      {
+         check(actual.stats.compiled == 1 && actual.stats.native_runs > 0, std::string{expression} + " runs natively");
+      }
+   }
+}
+
+int main()
+{
+   // Only a compile for an enabled JIT changes the bytecode
+   check(compile("var x = 1; x * x + 1;").jit_regions == 0, "no regions by default");
+   check(compile("var x = 1; x * x + 1;", eager).jit_regions == (lox::jit_supported() ? 1 : 0),
+         "regions marked for the JIT");
+
+   expect_same("x * x - 3 * x + 2");
+   expect_same("(x + y) / (x - y) * 2");
+   expect_same("x / 0 + y");
+   expect_same("-x * 0 - y");
+   expect_same("(x - x) / (x - x) + 1");
+   expect_same("x > y == (y < x)");
+   expect_same("x >= 1 != y <= 0");
+   expect_same("!(x > 0) == !!(y > 0)");
+   expect_same("x > 0 and y > 0");
+   // A boolean or a number depending on x, left to the interpreter
+   expect_same("x > 0 or y + 1", false);
+   check(run("var y = 1; for (var x = 0; x < 3; x = x + 1) print x > 1 or y + 1; nil;", eager).stats.rejected ==
+             (lox::jit_supported() ? 1 : 0),
+         "mixed types rejected");
+   expect_same("x > 1 and x < 2 or y * 3 > 1");
+   expect_same("x == 1 or x == 2.5");
+
+   // A local that stops being a number fails its guard, the interpreter finishes every such run
+   {
+      auto code = "var total = 0; for (var i = 0; i < 20; i = i + 1) { var x = i; if (i > 10) x = \"s\"; "
+                  "if (x == 3 or x == 4 or x == 5) total = total + 1; } total;";
+      auto expected = run(code, interpreter);
+      auto actual = run(code, eager);
+      check(actual.output == expected.output && actual.output == "3", "guard failures fall back");
+      if (lox::jit_supported())
+      {
+         check(actual.stats.guard_failures == eager.max_guard_failures, "guard failures counted");
+         check(actual.stats.deoptimized == 1, "region deoptimized after repeated failures");
+      }
+   }
+
+   // Type errors inside a hot region still come from the interpreter
+   {
+      auto code = "var x = 1; for (var i = 0; i < 10; i = i + 1) { if (i == 5) x = true; print -x * 2 + 1; }";
+      auto expected = run(code, interpreter);
+      check(expected.output.find("error: ") != std::string::npos, "interpreter raises");
+      check(run(code, eager).output == expected.output, "native region raises the same error");
+   }
+   {
+      auto code = "var x = 1; for (var i = 0; i < 10; i = i + 1) { if (i == 5) x = nil; print x + x * 2; }";
+      check(run(code, eager).output == run(code, interpreter).output, "nil operand raises the same error");
+   }
+
+   // Regions below the threshold stay interpreted
+   {
+      auto code = "var s = 0; for (var i = 0; i < 5; i = i + 1) { s = s + i * i - 1; } s;";
+      auto lazy = run(code, {.enabled = true, .hot_threshold = 100});
+      check(lazy.output == "25" && lazy.stats.compiled == 0 && lazy.stats.native_runs == 0, "cold region interpreted");
+   }
+
+   return test::finish("jit");
+}
@@ -0,0 +1,132 @@
+#include <lox/scanner.hpp>
+#include <lox/tokens.hpp>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   auto same(const std::vector<lox::Token> &a, const std::vector<lox::Token> &b) -> bool
+   {
+      if (a.size() != b.size())
+      {
+         return false;
+      }
+      for (std::size_t i = 0; i < a.size(); i++)
+      {
+         // Lexemes must point at the same bytes of the source, not just look alike
+         bool same_lexeme = a[i].get_lexeme().size() == b[i].get_lexeme().size() &&
+                            (a[i].get_lexeme().empty() || a[i].get_lexeme().data() == b[i].get_lexeme().data());
+         if (a[i].get_type() != b[i].get_type() || !same_lexeme || a[i].get_line() != b[i].get_line())
+         {
+            std::cout << "  first difference at token " << i << ": " << a[i].to_string() << " line " << a[i].get_line()
+                      << " vs " << b[i].to_string() << " line " << b[i].get_line() << std::endl;
+            return false;
+         }
+      }
+      return true;
+   }
+}
+
+int main()
+{
+   // Multi line strings whose lines look like code and comments are what chunking has to get right
+   std::string source;
+   for (int i = 0; source.size() < 1024 * 1024; i++)
+   {
+      source += "var v" + std::to_string(i) + " = " + std::to_string(i) + " * 2; // comment \"with quote\n";
+      if (i % 37 == 0)
+      {
+         source += "print \"multi\nline = 1;\n// not a comment\nstill string\";\n";
+      }
+      if (i % 101 == 0)
+      {
+         source += "\n\n   \t\n";
+      }
+   }
+
+   lox::Scanner sequential_scanner{source};
+   auto expected = sequential_scanner.scan_tokens();
+
+   int failures = 0;
+   for (unsigned int threads : {2u, 3u, 4u, 7u, 16u, 64u})
+   {
+      lox::Scanner scanner{source};
+      if (!same(scanner.scan_tokens_parallel(threads), expected))
+      {
+         std::cout << "FAIL: parallel scan with " << threads << " threads differs" << std::endl;
+         failures++;
+      }
+   }
+
+   // Indented code and blank lines: chunks start after the whitespace the previous chunk skips,
+   // so without multi line strings every speculative scan holds
+   std::string indented;
+   for (int i = 0; indented.size() < 1024 * 1024; i++)
+   {
+      indented += "fun f" + std::to_string(i) + "(a) {\n    if (a > " + std::to_string(i) +
+                  ") {\n\t\tprint a;  \n    }\n\n  \n    return a; // done\n}\n";
+   }
+   lox::Scanner indented_sequential{indented};
+   auto indented_expected = indented_sequential.scan_tokens();
+   for (unsigned int threads : {2u, 4u, 7u, 16u})
+   {
+      lox::Scanner scanner{indented};
+      if (!same(scanner.scan_tokens_parallel(threads), indented_expected))
+      {
+         std::cout << "FAIL: parallel scan of indented code with " << threads << " threads differs" << std::endl;
+         failures++;
+      }
+      if (scanner.rescanned_chunks() != 0)
+      {
+         std::cout << "FAIL: " << scanner.rescanned_chunks() << " chunks of indented code rescanned with " << threads
+                   << " threads" << std::endl;
+         failures++;
+      }
+   }
+
+   // A string that never closes swallows everything after it
+   std::string unterminated = source.substr(0, source.size() / 3) + "\"open\n" + source.substr(source.size() / 3);
+   lox::Scanner unterminated_sequential{unterminated};
+   lox::Scanner unterminated_parallel{unterminated};
+   if (!same(unterminated_parallel.scan_tokens_parallel(4), unterminated_sequential.scan_tokens()))
+   {
+      std::cout << "FAIL: parallel scan with an unterminated string differs" << std::endl;
+      failures++;
+   }
+
+   // Scans on several threads at once share the worker threads
+   {
+      std::vector<int> agree(4, 0);
+      std::vector<std::thread> callers;
+      for (std::size_t t = 0; t < agree.size(); t++)
+      {
+         callers.emplace_back(
+             [&, t]
+             {
+                for (int i = 0; i < 5; i++)
+                {
+                   lox::Scanner scanner{t % 2 == 0 ? source : indented};
+                   agree[t] += same(scanner.scan_tokens_parallel(4), t % 2 == 0 ? expected : indented_expected);
+                }
+             });
+      }
+      for (auto &caller : callers)
+      {
+         caller.join();
+      }
+      for (auto count : agree)
+      {
+         if (count != 5)
+         {
+            std::cout << "FAIL: concurrent parallel scans differ" << std::endl;
+            failures++;
+         }
+      }
+   }
+
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+#include <lox/arena.hpp>
+#include <lox/ast.hpp>
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/diagnostics.hpp>
+#include <lox/parser.hpp>
+#include <lox/scanner.hpp>
+
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+int main()
+{
+   // A long operator chain must allocate exactly one node per operand and operator,
+   // building Binary nodes by copying subtrees would show up as extra allocations
+   constexpr std::size_t operands = 10'000;
+   std::string code = "x";
+   for (std::size_t i = 1; i < operands; i++)
+   {
+      code += " + x";
+   }
+   code += ";";
+
+   lox::Scanner scanner{code};
+   std::vector<lox::Token> tokens = scanner.scan_tokens();
+
+   lox::Arena arena;
+   lox::Parser parser{tokens, arena};
+   auto expressions = parser.parse_expression();
+
+   if (expressions.size() != 1)
+   {
+      std::cout << "expected one expression, got " << expressions.size() << std::endl;
+      return 1;
+   }
+   if (arena.allocations() != 2 * operands - 1)
+   {
+      std::cout << "expected " << 2 * operands - 1 << " nodes, got " << arena.allocations() << std::endl;
+      return 1;
+   }
+
+   // Left associative: the root's right operand is the last variable
+   const auto &root = std::get<lox::Box<lox::Binary>>(expressions[0]);
+   if (!std::holds_alternative<lox::Box<lox::Variable>>(root->right))
+   {
+      std::cout << "expected a left associative chain" << std::endl;
+      return 1;
+   }
+
+   // Parsing straight from the scanner must build the same program as parsing the token array
+   std::string_view program = "var a = 1; { var b = a * (2 + 3); print b >= 5 and !nil; }\n"
+                              "for (var i = 0; i < 3; i = i + 1) if (i == 1) a = a + i; else print \"x\";";
+   lox::Scanner array_scanner{program};
+   std::vector<lox::Token> program_tokens = array_scanner.scan_tokens();
+   lox::Parser array_parser{program_tokens};
+   lox::Chunk from_array = lox::Compiler{}.compile(array_parser.parse());
+
+   lox::Scanner stream_scanner{program};
+   lox::Parser stream_parser{stream_scanner};
+   lox::Chunk from_stream = lox::Compiler{}.compile(stream_parser.parse());
+
+   if (from_array.code != from_stream.code || from_array.constants != from_stream.constants)
+   {
+      std::cout << "streaming parse differs from parsing the token array" << std::endl;
+      return 1;
+   }
+
+   // Every broken statement is reported once, parsing resumes at the next statement
+   std::string_view broken = "var = 1;\n"
+                             "print (1 + ;\n"
+                             "var ok = 2;\n"
+                             "{ 1 + 2 = 3; print ok }\n"
+                             "class return - -";
+   lox::Scanner broken_scanner{broken};
+   std::vector<lox::Token> broken_tokens = broken_scanner.scan_tokens();
+   lox::Parser broken_parser{broken_tokens, broken_scanner.diagnostics()};
+   broken_parser.parse();
+
+   using Code = lox::DiagnosticCode;
+   struct Expected
+   {
+      Code code;
+      unsigned int line;
+      unsigned int column;
+   };
+   std::vector<Expected> expected{{Code::expected_token, 0, 4},
+                                  {Code::expected_expression, 1, 11},
+                                  {Code::invalid_assignment_target, 3, 8},
+                                  {Code::expected_token, 3, 22},
+                                  {Code::expected_token, 4, 6},
+                                  {Code::expected_expression, 4, 6}};
+   auto diagnostics = broken_scanner.diagnostics().entries();
+   bool matches = diagnostics.size() == expected.size();
+   for (std::size_t i = 0; matches && i < expected.size(); i++)
+   {
+      matches = diagnostics[i].code == expected[i].code && diagnostics[i].line == expected[i].line &&
+                diagnostics[i].column == expected[i].column;
+   }
+   if (!matches || !broken_parser.had_error())
+   {
+      std::cout << "unexpected diagnostics:" << std::endl;
+      for (const auto &diagnostic : diagnostics)
+      {
+         std::cout << "  " << broken_scanner.diagnostics().format(diagnostic) << std::endl;
+      }
+      return 1;
+   }
+
+   // Lexical errors land in the same sink as the syntax errors they cause,
+   // the std::expected API hands them all back instead of a program
+   lox::Arena program_arena;
+   auto lexical = lox::parse_program("var a = 1 # 2;\nprint \"open", program_arena);
+   if (lexical.has_value() || lexical.error().error_count() != 4 ||
+       lexical.error().entries()[0].code != Code::unexpected_character ||
+       lexical.error().format(lexical.error().entries()[0]) != "[line 0:10] Error at '#': unexpected character." ||
+       lexical.error().entries()[2].code != Code::unterminated_string)
+   {
+      std::cout << "expected the lexical errors of the program" << std::endl;
+      return 1;
+   }
+   auto parsed = lox::parse_program(program, program_arena);
+   if (!parsed.has_value() || parsed->size() != 3)
+   {
+      std::cout << "expected a program of three statements" << std::endl;
+      return 1;
+   }
+
+   // '.' and '(' bind tighter than any operator, an assignment to a property becomes a Set
+   auto access = lox::parse_program("a.b.c = d(1, 2).e;", program_arena);
+   const auto *set = access.has_value() && access->size() == 1
+                         ? std::get_if<lox::Box<lox::Set>>(&std::get<lox::Box<lox::Expression>>((*access)[0])->expression)
+                         : nullptr;
+   const auto *object = set != nullptr ? std::get_if<lox::Box<lox::Get>>(&(*set)->object) : nullptr;
+   const auto *value = set != nullptr ? std::get_if<lox::Box<lox::Get>>(&(*set)->value) : nullptr;
+   const auto *call = value != nullptr ? std::get_if<lox::Box<lox::Call>>(&(*value)->object) : nullptr;
+   if (object == nullptr || (*set)->name.get_lexeme() != "c" || (*object)->name.get_lexeme() != "b" ||
+       call == nullptr || (*call)->arguments.size() != 2)
+   {
+      std::cout << "expected a.b.c = d(1, 2).e to parse as a Set of a call's property" << std::endl;
+      return 1;
+   }
+   auto misplaced = lox::parse_program("a + b.c = 1;", program_arena);
+   if (misplaced.has_value() || misplaced.error().entries()[0].code != Code::invalid_assignment_target)
+   {
+      std::cout << "expected a + b.c = 1 to be an invalid assignment target" << std::endl;
+      return 1;
+   }
+
+   // Columns of thousands of errors on one line, each found without searching the line from its start
+   {
+      std::string long_line;
+      for (int i = 0; i < 5000; i++)
+      {
+         long_line += "@ ";
+      }
+      long_line += "\nprint (1 + ;";
+      lox::Arena arena;
+      auto errors = lox::parse_program(long_line, arena);
+      auto entries = errors.has_value() ? std::span<const lox::Diagnostic>{} : errors.error().entries();
+      if (entries.size() != 5001 || entries[4999].column != 9998 || entries[5000].line != 1 ||
+          entries[5000].column != 11)
+      {
+         std::cout << "expected columns of every error on a long line" << std::endl;
+         return 1;
+      }
+   }
+
+   // The '}' closing a block is never taken for a missing operand, only the operand is reported
+   auto unclosed = lox::parse_program("{ print }", program_arena);
+   if (unclosed.has_value() || unclosed.error().error_count() != 1 ||
+       unclosed.error().entries()[0].code != Code::expected_expression || unclosed.error().entries()[0].column != 8)
+   {
+      std::cout << "expected { print } to report only the missing expression" << std::endl;
+      return 1;
+   }
+   // Outside a block a stray '}' is skipped like any other bad operand
+   auto stray = lox::parse_program("print } print 1;", program_arena);
+   if (stray.has_value() || stray.error().error_count() != 1)
+   {
+      std::cout << "expected print } to report one error" << std::endl;
+      return 1;
+   }
+
+   // A moved-from arena owns nothing and allocates into fresh blocks, never the new owner's
+   {
+      lox::Arena source;
+      auto *kept = source.make<int>(1);
+      lox::Arena owner{std::move(source)};
+      auto *fresh = source.make<int>(2);
+      auto *next = owner.make<int>(3);
+      if (*kept != 1 || *fresh != 2 || *next != 3 || owner.block_count() != 1 || source.block_count() != 1)
+      {
+         std::cout << "expected a moved-from arena to start over" << std::endl;
+         return 1;
+      }
+      owner = std::move(source);
+      if (*fresh != 2 || owner.block_count() != 1 || source.block_count() != 0 || source.bytes_allocated() != 0)
+      {
+         std::cout << "expected move assignment to hand over the blocks" << std::endl;
+         return 1;
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,130 @@
+#include "test_support.hpp"
+
+#include <lox/lox.hpp>
+#include <lox/program.hpp>
+#include <lox/tokens.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   using test::check;
+
+   // Strings, classes with inline caches and a hot arithmetic loop, all state a run creates in its VM
+   const std::string script = "class Point {} var p = Point(); p.x = 0; var name = \"po\" + \"int\";\n"
+                              "for (var i = 0; i < 200; i = i + 1) { p.x = p.x + i * 2 - 1; }\n"
+                              "print name; print p.x; p.x * 0.5;";
+}
+
+int main()
+{
+   auto program = lox::compile_program(script);
+   check(program.has_value(), "script compiles");
+   if (!program)
+   {
+      return 1;
+   }
+
+   std::string expected;
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto value = lox::stringify(vm.run(*program));
+      expected = out.str() + value;
+      check(expected == "point\n39600\n19800", "single run output");
+   }
+
+   // Workers share the Program and each reuse their own VM, resetting it between independent runs
+   {
+      constexpr int runs = 50;
+      std::vector<std::string> results(4);
+      std::vector<std::thread> workers;
+      for (auto &result : results)
+      {
+         workers.emplace_back(
+             [&]
+             {
+                std::ostringstream out;
+                lox::VM vm{out};
+                for (int i = 0; i < runs; i++)
+                {
+                   out.str("");
+                   auto value = lox::stringify(vm.run(*program));
+                   if (out.str() + value != expected)
+                   {
+                      return;
+                   }
+                   vm.reset();
+                }
+                result = expected;
+             });
+      }
+      for (auto &worker : workers)
+      {
+         worker.join();
+      }
+      for (const auto &result : results)
+      {
+         check(result == expected, "concurrent runs of one program");
+      }
+   }
+
+   // Every call compiles on its own Scanner, Parser and Compiler
+   {
+      std::vector<lox::Chunk> chunks(4);
+      std::vector<std::thread> workers;
+      for (auto &chunk : chunks)
+      {
+         workers.emplace_back([&] { chunk = lox::compile_program(script)->chunk(); });
+      }
+      for (auto &worker : workers)
+      {
+         worker.join();
+      }
+      for (const auto &chunk : chunks)
+      {
+         check(chunk.code == program->chunk().code && chunk.constants == program->chunk().constants,
+               "concurrent compiles agree");
+      }
+   }
+
+   // Copies share the compiled code
+   {
+      auto copy = *program;
+      check(&copy.chunk() == &program->chunk(), "copies share the chunk");
+   }
+
+   // A reset VM has no globals left from earlier runs
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      vm.run(*lox::compile_program("var leftover = 1;"));
+      check(lox::stringify(vm.run(*lox::compile_program("leftover;"))) == "1", "globals survive runs");
+      vm.reset();
+      auto undefined = false;
+      try
+      {
+         vm.run(*lox::compile_program("leftover;"));
+      }
+      catch (LoxException &)
+      {
+         undefined = true;
+      }
+      check(undefined, "reset forgets globals");
+      check(lox::stringify(vm.run(*program)) == "19800", "reset VM runs again");
+   }
+
+   auto broken = lox::compile_program("var = 1;");
+   check(!broken.has_value() && broken.error().has_errors(), "syntax errors are returned");
+
+   check(lox::token_names[lox::as_integer(lox::TokenType::eof_tok)] == "end of file", "token names by type");
+
+   return test::finish("program");
+}
@@ -0,0 +1,163 @@
+#include "test_support.hpp"
+
+#include <lox/inline_cache.hpp>
+#include <lox/lox.hpp>
+#include <lox/object.hpp>
+#include <lox/value.hpp>
+#include <lox/vm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+   using test::check;
+   using test::compile;
+   using test::failures;
+
+   void expect(std::string_view code, std::string_view result, std::string_view output = "")
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto value = lox::stringify(vm.run(compile(code)));
+      if (value != result || out.str() != output)
+      {
+         std::cout << "FAIL: " << code << "\n  result: " << value << " (expected " << result << ")"
+                   << "\n  output: " << out.str() << " (expected " << output << ")" << std::endl;
+         failures++;
+      }
+   }
+
+   void expect_error(std::string_view code, std::string_view message)
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      try
+      {
+         vm.run(compile(code));
+         std::cout << "FAIL: expected an error from " << code << std::endl;
+         failures++;
+      }
+      catch (LoxException &error)
+      {
+         if (std::string_view{error.what()}.find(message) == std::string_view::npos)
+         {
+            std::cout << "FAIL: " << code << "\n  error: " << error.what() << " (expected " << message << ")"
+                      << std::endl;
+            failures++;
+         }
+      }
+   }
+
+   // Reads o.v at one site, cycling o through the first `shapes` of five instances built with different layouts
+   auto polymorphic_loop(int shapes, int iterations) -> std::string
+   {
+      return "class C {}\n"
+             "var a = C(); a.v = 1;\n"
+             "var b = C(); b.w = 0; b.v = 1;\n"
+             "var c = C(); c.x = 0; c.v = 1;\n"
+             "var d = C(); d.y = 0; d.z = 0; d.v = 1;\n"
+             "var e = C(); e.z = 0; e.v = 1;\n"
+             "var o = a; var k = 0; var sum = 0;\n"
+             "for (var i = 0; i < " +
+             std::to_string(iterations) +
+             "; i = i + 1) {\n"
+             "  if (k == 0) o = a; if (k == 1) o = b; if (k == 2) o = c; if (k == 3) o = d; if (k == 4) o = e;\n"
+             "  k = k + 1; if (k == " +
+             std::to_string(shapes) +
+             ") k = 0;\n"
+             "  sum = sum + o.v;\n"
+             "}\n"
+             "sum;";
+   }
+}
+
+int main()
+{
+   expect("class Point {} Point;", "Point");
+   expect("class Point {} Point();", "Point instance");
+   expect("class P {} var p = P(); p.x = 1; p.y = 2; p.x + p.y;", "3");
+   expect("class P {} var p = P(); p.x = 1; p.x = p.x + 1; p.x;", "2");
+   expect("class P {} var p = P(); p.x = p.y = 3; p.x + p.y;", "6");
+   expect("class P {} var p = P(); p.inner = P(); p.inner.name = \"in\"; p.inner.name;", "in");
+   expect("{ class P {} var p = P(); p.a = \"s\"; print p.a; }", "nil", "s\n");
+
+   expect_error("1.x;", "Only instances have properties.");
+   expect_error("class P {} P().x;", "Undefined property 'x'.");
+   expect_error("class P {} var p = P(); \"s\".x = 1;", "Only instances have fields.");
+   expect_error("var f = 1; f();", "Can only call functions and classes.");
+   expect_error("class P {} P(1);", "Expected 0 arguments but got 1.");
+
+   // Instances gaining the same fields in the same order share a shape, another order makes another one
+   {
+      lox::Heap heap;
+      auto *klass = heap.make_class(heap.intern("C"));
+      auto *x = heap.intern("x");
+      auto *y = heap.intern("y");
+      auto *xy = heap.transition(heap.transition(heap.empty_shape(), x), y);
+      check(heap.transition(heap.transition(heap.empty_shape(), x), y) == xy, "same layout, same shape");
+      auto *yx = heap.transition(heap.transition(heap.empty_shape(), y), x);
+      check(yx != xy, "another order, another shape");
+      check(xy->find(x) == 0 && xy->find(y) == 1 && yx->find(x) == 1, "slots follow the insertion order");
+      check(xy->find(heap.intern("z")) == -1, "missing names have no slot");
+
+      auto *instance = heap.make_instance(klass);
+      check(instance->shape == heap.empty_shape() && instance->fields.empty(), "instances start empty");
+   }
+
+   // A site that only sees one shape misses once, then every access hits the first entry
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto result = vm.run(compile("class P {} var p = P(); p.x = 2; var sum = 0;"
+                                   "for (var i = 0; i < 100; i = i + 1) { sum = sum + p.x; } sum;"));
+      check(lox::stringify(result) == "200", "monomorphic loop result");
+      const auto &stats = vm.ic_stats();
+      check(stats.misses == 2, "one miss for the set, one for the get");
+      check(stats.monomorphic_hits == 99 && stats.polymorphic_hits == 0, "monomorphic hits");
+      check(stats.hit_rate() > 0.95, "monomorphic hit rate");
+   }
+
+   // Up to four shapes stay cached at one site
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto result = vm.run(compile(polymorphic_loop(4, 400)));
+      check(lox::stringify(result) == "400", "polymorphic loop result");
+      const auto &stats = vm.ic_stats();
+      check(stats.misses == 10 + 4, "polymorphic misses: one per set while building, one per shape at the site");
+      check(stats.monomorphic_hits == 99, "polymorphic site hits its first entry");
+      check(stats.polymorphic_hits == 297, "polymorphic site hits the other entries");
+      check(stats.megamorphic_misses == 0, "four shapes are not megamorphic");
+   }
+
+   // A fifth shape makes the site megamorphic, that shape is looked up on every access
+   {
+      std::ostringstream out;
+      lox::VM vm{out};
+      auto result = vm.run(compile(polymorphic_loop(5, 500)));
+      check(lox::stringify(result) == "500", "megamorphic loop result");
+      check(vm.ic_stats().megamorphic_misses == 100, "megamorphic misses");
+   }
+
+   // Instances, their classes, field values and field names survive collections at every allocation
+   for (auto mode : {lox::GcMode::stop_the_world, lox::GcMode::incremental})
+   {
+      std::ostringstream out;
+      lox::VM vm{out, {.mode = mode, .initial_heap_size = 1024, .stress = mode == lox::GcMode::stop_the_world,
+                       .step_budget = 4}};
+      auto result = vm.run(compile("class Node {} var head = nil;"
+                                   "for (var i = 0; i < 300; i = i + 1) {"
+                                   "  var node = Node(); node.next = head; node.text = \"n\" + \"x\"; head = node;"
+                                   "}"
+                                   "var count = 0; var text = \"\";"
+                                   "while (head != nil) { count = count + 1; text = head.text; head = head.next; }"
+                                   "count;"));
+      check(lox::stringify(result) == "300", "instances survive collections");
+      check(vm.gc_stats().collections > 0, "collections ran");
+   }
+
+   return test::finish("property");
+}
@@ -0,0 +1,114 @@
+#include <lox/arena.hpp>
+#include <lox/ast.hpp>
+#include <lox/parser.hpp>
+#include <lox/resolver.hpp>
+#include <lox/scanner.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace
+{
+   int failures = 0;
+
+   using Kind = lox::Binding::Kind;
+
+   struct Expected
+   {
+      std::string_view name;
+      Kind kind;
+      std::uint16_t depth;
+      std::uint16_t slot;
+   };
+
+   // Collects the binding of every variable use in source order
+   struct Uses
+   {
+      std::vector<std::pair<std::string_view, lox::Binding>> found;
+
+      void statement(const lox::Stmt &stmt)
+      {
+         std::visit(lox::visit_overloader{[&](const lox::Box<lox::Expression> &node) { expression(node->expression); },
+                                          [&](const lox::Box<lox::Print> &node) { expression(node->expression); },
+                                          [&](const lox::Box<lox::Var> &node) { expression(node->initializer); },
+                                          [&](const lox::Box<lox::Block> &node)
+                                          {
+                                             for (const auto &inner : node->statements)
+                                             {
+                                                statement(inner);
+                                             }
+                                          },
+                                          [&](const auto &) {}},
+                    stmt);
+      }
+
+      void expression(const lox::Expr &expr)
+      {
+         std::visit(lox::visit_overloader{[&](const lox::Box<lox::Variable> &node)
+                                          { found.emplace_back(node->token.get_lexeme(), node->binding); },
+                                          [&](const lox::Box<lox::Assign> &node)
+                                          {
+                                             expression(node->value);
+                                             found.emplace_back(node->name.get_lexeme(), node->binding);
+                                          },
+                                          [&](const lox::Box<lox::Binary> &node)
+                                          {
+                                             expression(node->left);
+                                             expression(node->right);
+                                          },
+                                          [&](const auto &) {}},
+                    expr);
+      }
+   };
+
+   void expect(std::string_view code, std::vector<Expected> expected)
+   {
+      lox::Scanner scanner{code};
+      std::vector<lox::Token> tokens = scanner.scan_tokens();
+      lox::Parser parser{tokens};
+      auto program = parser.parse();
+      lox::Resolver{}.resolve(program);
+
+      Uses uses;
+      for (const auto &stmt : program)
+      {
+         uses.statement(stmt);
+      }
+      bool matches = uses.found.size() == expected.size();
+      for (std::size_t i = 0; matches && i < expected.size(); i++)
+      {
+         const auto &[name, binding] = uses.found[i];
+         matches = name == expected[i].name && binding.kind == expected[i].kind && binding.depth == expected[i].depth &&
+                   binding.slot == expected[i].slot;
+      }
+      if (!matches)
+      {
+         std::cout << "FAIL: " << code << std::endl;
+         for (const auto &[name, binding] : uses.found)
+         {
+            std::cout << "  " << name << " kind " << static_cast<int>(binding.kind) << " depth " << binding.depth
+                      << " slot " << binding.slot << std::endl;
+         }
+         failures++;
+      }
+   }
+}
+
+int main()
+{
+   expect("var a = 1; var b = a; b = a + b;",
+          {{"a", Kind::global, 0, 0}, {"a", Kind::global, 0, 0}, {"b", Kind::global, 0, 1}, {"b", Kind::global, 0, 1}});
+   expect("{ var a = 1; { var b = a; { a = b; } } }",
+          {{"a", Kind::local, 1, 0}, {"b", Kind::local, 1, 1}, {"a", Kind::local, 2, 0}});
+   // Shadowing binds to the innermost declaration, sibling blocks reuse slots
+   expect("var a; { var a = 1; { var b = a + 1; } } { var c = 2; c; } a;",
+          {{"a", Kind::local, 1, 0}, {"c", Kind::local, 0, 0}, {"a", Kind::global, 0, 0}});
+   // Globals used before any definition still get a slot, the VM reports them if never defined
+   expect("{ var x = later; } var later = 1;", {{"later", Kind::global, 1, 0}});
+
+   return failures == 0 ? 0 : 1;
+}
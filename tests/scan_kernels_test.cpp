@@ -0,0 +1,63 @@
+#include <lox/scan_kernels.hpp>
+#include <lox/scanner.hpp>
+#include <lox/tokens.hpp>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+   auto describe(const std::vector<lox::Token> &tokens) -> std::vector<std::string>
+   {
+      std::vector<std::string> lines;
+      for (const auto &token : tokens)
+      {
+         lines.push_back(std::to_string(token.get_line()) + " " + token.to_string());
+      }
+      return lines;
+   }
+}
+
+int main()
+{
+   // Runs longer than one vector plus tails of every length, so both the
+   // vector loops and the scalar remainders are exercised
+   std::string source;
+   for (std::size_t n = 0; n < 70; n++)
+   {
+      source += std::string(n, ' ') + "\t\r\n";
+      source += "ident_" + std::string(n, 'x') + "9 ";
+      source += std::string(n, '7') + "." + std::string(n % 5 + 1, '3') + ";";
+      source += "// comment " + std::string(n, '-') + "\n";
+      source += "\"string " + std::string(n, 's') + "\nsecond line\"" + std::string(n % 7, '\n');
+      source += "var while_ = whilex or and_ != nil;\n";
+   }
+   source += "\"unterminated " + std::string(40, 'u');
+
+   lox::Scanner scalar{source, lox::scan_kernels(lox::SimdLevel::scalar)};
+   auto expected = describe(scalar.scan_tokens());
+
+   int failures = 0;
+   for (auto level : {lox::SimdLevel::sse2, lox::SimdLevel::avx2})
+   {
+      lox::Scanner scanner{source, lox::scan_kernels(level)};
+      auto actual = describe(scanner.scan_tokens());
+      if (actual != expected)
+      {
+         std::cout << "FAIL: token stream differs for simd level " << static_cast<int>(level) << std::endl;
+         for (std::size_t i = 0; i < actual.size() && i < expected.size(); i++)
+         {
+            if (actual[i] != expected[i])
+            {
+               std::cout << "  at token " << i << ": " << actual[i] << " vs " << expected[i] << std::endl;
+               break;
+            }
+         }
+         failures++;
+      }
+   }
+
+   return failures == 0 ? 0 : 1;
+}
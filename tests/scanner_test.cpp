@@ -1,7 +1,16 @@
+#include "test_support.hpp"
+
 #include <lox/scanner.hpp>
 #include <lox/parser.hpp>
+#include <lox/tokens.hpp>
+
+#include <string>
 #include <string_view>
 #include <iostream>
+#include <variant>
+#include <vector>
+
+using test::check;
 
 int main()
 {
@@ -17,6 +26,151 @@ int main()
    lox::Parser parser{tokens};
    parser.parse_expression();
 
+   // Literals are decoded from the lexeme, only numbers and strings have one
+   {
+      lox::Scanner literals{"12.5 \"text\" + name \"\";"};
+      auto scanned = literals.scan_tokens();
+      check(scanned.size() == 7, "literal tokens scanned");
+      check(std::get<double>(scanned[0].get_literal()) == 12.5, "number literal");
+      check(scanned[1].get_lexeme() == "\"text\"", "string lexeme keeps its quotes");
+      check(std::get<std::string_view>(scanned[1].get_literal()) == "text", "string literal without quotes");
+      check(std::get<std::string_view>(scanned[4].get_literal()).empty(), "empty string literal");
+      check(std::holds_alternative<std::monostate>(scanned[2].get_literal()), "punctuation has no literal");
+      check(std::holds_alternative<std::monostate>(scanned[3].get_literal()), "identifier has no literal");
+      check(std::holds_alternative<std::monostate>(scanned[5].get_literal()), "semicolon has no literal");
+   }
+
+   // Lexemes point into the source wherever they are, also past 64K and in literals of that size.
+   // Lines count from 0
+   {
+      std::string source;
+      for (int i = 0; i < 20000; i++)
+      {
+         source += "var v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+      }
+      auto long_string_start = source.size();
+      source += "\"" + std::string(70000, 'a') + "\";";
+      lox::Scanner long_scanner{source};
+      auto scanned = long_scanner.scan_tokens();
+      check(scanned.size() == 20000 * 5 + 3, "long source scanned");
+      const auto &last_name = scanned[19999 * 5 + 1];
+      check(last_name.get_lexeme() == "v19999" && last_name.get_line() == 19999, "identifier far into the source");
+      check(last_name.get_lexeme().data() == source.data() + source.rfind("v19999"), "lexeme points into the source");
+      check(std::get<double>(scanned[19999 * 5 + 3].get_literal()) == 19999, "number far into the source");
+      const auto &text = scanned[20000 * 5];
+      check(text.get_lexeme().data() == source.data() + long_string_start && text.get_lexeme().size() == 70002,
+            "long string lexeme");
+      check(std::get<std::string_view>(text.get_literal()) == std::string(70000, 'a'), "long string literal");
+   }
+
+   // Lines saturate at the 24 bits a token keeps for them
+   {
+      check(lox::Token::max_line == (1u << 24) - 1, "max line is 2^24-1");
+      check(lox::Token(lox::TokenType::identifier_tok, "x", 7).get_line() == 7, "small line kept");
+      check(lox::Token(lox::TokenType::identifier_tok, "x", lox::Token::max_line - 1).get_line() ==
+                lox::Token::max_line - 1,
+            "line below the limit kept");
+      check(lox::Token(lox::TokenType::identifier_tok, "x", lox::Token::max_line).get_line() == lox::Token::max_line,
+            "line at the limit kept");
+      check(lox::Token(lox::TokenType::identifier_tok, "x", lox::Token::max_line + 1).get_line() ==
+                lox::Token::max_line,
+            "line past the limit clamped");
+      check(lox::Token(lox::TokenType::identifier_tok, "x", ~0u).get_line() == lox::Token::max_line,
+            "largest line clamped");
+      std::string source(lox::Token::max_line + 10, '\n');
+      source += "x";
+      lox::Scanner clamped{source};
+      auto scanned = clamped.scan_tokens();
+      check(scanned.size() == 2 && scanned[0].get_lexeme() == "x" && scanned[0].get_line() == lox::Token::max_line,
+            "scanner clamps lines past the limit");
+   }
+
+   // Every keyword scans to its type, words near one stay identifiers
+   {
+      auto scan_one = [](std::string_view text)
+      {
+         lox::Scanner one{text};
+         auto scanned = one.scan_tokens();
+         auto whole = scanned.size() == 2 && scanned[0].get_lexeme() == text;
+         return whole ? scanned[0].get_type() : lox::TokenType::eof_tok;
+      };
+      auto is_keyword = [](std::string_view text)
+      {
+         for (const auto &keyword : lox::keywords)
+         {
+            if (keyword.text == text)
+            {
+               return true;
+            }
+         }
+         return false;
+      };
+      auto expect_identifier = [&](const std::string &text)
+      {
+         if (!is_keyword(text))
+         {
+            check(scan_one(text) == lox::TokenType::identifier_tok, "near miss " + text + " is an identifier");
+         }
+      };
+
+      for (const auto &keyword : lox::keywords)
+      {
+         std::string text{keyword.text};
+         check(scan_one(text) == keyword.type, text + " scans as its keyword");
+         check(lox::keyword_type(text) == keyword.type, text + " classified as its keyword");
+
+         // Prefixes, wrong lengths and one letter changes
+         for (std::size_t length = 1; length < text.size(); length++)
+         {
+            expect_identifier(text.substr(0, length));
+         }
+         expect_identifier(text + text.back());
+         expect_identifier(text + "_");
+         expect_identifier("_" + text);
+         for (std::size_t i = 0; i < text.size(); i++)
+         {
+            for (char letter : {'a', 'q', 'z', '_'})
+            {
+               auto changed = text;
+               changed[i] = letter;
+               expect_identifier(changed);
+            }
+            auto upper = text;
+            upper[i] = static_cast<char>(upper[i] - 'a' + 'A');
+            expect_identifier(upper);
+         }
+      }
+      for (const auto *text : {"classs", "fo", "nill", "whale", "th", "superb", "els", "tru", "var1", "Nil"})
+      {
+         expect_identifier(text);
+      }
+
+      // Words with a keyword's hash, same first and last letter and length or any other colliding triple
+      std::size_t collisions = 0;
+      for (const auto &keyword : lox::keywords)
+      {
+         auto slot = lox::detail::keyword_hash(keyword.text, lox::detail::keyword_seed);
+         for (char first = 'a'; first <= 'z'; first++)
+         {
+            for (char last = 'a'; last <= 'z'; last++)
+            {
+               for (std::size_t length = lox::detail::keyword_min_length; length <= lox::detail::keyword_max_length;
+                    length++)
+               {
+                  std::string text(length, 'x');
+                  text.front() = first;
+                  text.back() = last;
+                  if (lox::detail::keyword_hash(text, lox::detail::keyword_seed) == slot && !is_keyword(text))
+                  {
+                     collisions++;
+                     expect_identifier(text);
+                  }
+               }
+            }
+         }
+      }
+      check(collisions > lox::keywords.size(), "colliding words tested");
+   }
 
-   return 0;
-}
\ No newline at end of file
+   return test::finish("scanner");
+}
@@ -0,0 +1,79 @@
+#include "test_support.hpp"
+
+#include <lox/lox.hpp>
+#include <lox/scanner.hpp>
+#include <lox/source_file.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+using test::check;
+
+int main()
+{
+   std::string script;
+   for (int i = 0; i < 5000; i++)
+   {
+      script += "var v" + std::to_string(i) + " = \"text\" + " + std::to_string(i) + ";\n";
+   }
+
+   auto path = std::filesystem::temp_directory_path() / ("lox_source_file_test_" + std::to_string(::getpid()) + ".lox");
+   std::ofstream(path, std::ios::binary) << script;
+
+   {
+      auto source = lox::SourceFile::open(path);
+      check(source.is_mapped(), "regular files are memory mapped");
+      check(source.view() == script, "mapped view matches the file");
+
+      // Moving keeps the mapping, tokens scanned from the view stay valid
+      auto moved = std::move(source);
+      lox::Scanner scanner{moved.view()};
+      check(scanner.scan_tokens().size() == 5000 * 7 + 1, "scanner reads the mapped file");
+   }
+
+   std::filesystem::resize_file(path, 0);
+   check(lox::SourceFile::open(path).view().empty(), "empty files open as an empty view");
+   std::filesystem::remove(path);
+
+   // Pipes can't be mapped and fall back to buffered reads
+   int fds[2];
+   check(::pipe(fds) == 0, "pipe created");
+   std::thread writer([&]
+                      {
+      std::string_view rest = script;
+      while (!rest.empty())
+      {
+         auto written = ::write(fds[1], rest.data(), rest.size());
+         if (written <= 0)
+         {
+            break;
+         }
+         rest.remove_prefix(static_cast<std::size_t>(written));
+      }
+      ::close(fds[1]); });
+   auto piped = lox::SourceFile::read(fds[0]);
+   writer.join();
+   ::close(fds[0]);
+   check(!piped.is_mapped(), "pipes are read into a buffer");
+   check(piped.view() == script, "buffered view matches what was written");
+
+   bool threw = false;
+   try
+   {
+      auto missing = lox::SourceFile::open("/nonexistent/lox/script.lox");
+   }
+   catch (LoxException &)
+   {
+      threw = true;
+   }
+   check(threw, "missing files throw");
+
+   return test::finish("source file");
+}
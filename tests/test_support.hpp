@@ -0,0 +1,53 @@
+#ifndef TEST_SUPPORT_HPP
+#define TEST_SUPPORT_HPP
+
+#include <lox/arena.hpp>
+#include <lox/chunk.hpp>
+#include <lox/compiler.hpp>
+#include <lox/jit.hpp>
+#include <lox/lox.hpp>
+#include <lox/parser.hpp>
+
+#include <iostream>
+#include <string_view>
+
+// Helpers shared by the test programs, each program counts its own failures
+namespace test
+{
+   inline int failures = 0;
+
+   inline void check(bool condition, std::string_view what)
+   {
+      if (!condition)
+      {
+         std::cout << "FAIL: " << what << std::endl;
+         failures++;
+      }
+   }
+
+   // Syntax errors throw like runtime errors, with the first diagnostic as the message
+   inline auto compile(std::string_view code, lox::JitConfig jit = {}) -> lox::Chunk
+   {
+      lox::Arena arena;
+      auto program = lox::parse_program(code, arena);
+      if (!program)
+      {
+         throw LoxException(program.error().format(program.error().entries()[0]));
+      }
+      return lox::Compiler{jit}.compile(*program);
+   }
+
+   // Exit status of the test program, prints the failure count or that every test of the suite passed
+   inline auto finish(std::string_view suite) -> int
+   {
+      if (failures != 0)
+      {
+         std::cout << failures << " failures" << std::endl;
+         return 1;
+      }
+      std::cout << suite << " tests passed" << std::endl;
+      return 0;
+   }
+}
+
+#endif
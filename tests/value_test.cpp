@@ -0,0 +1,41 @@
+#include "test_support.hpp"
+
+#include <lox/object.hpp>
+#include <lox/tokens.hpp>
+#include <lox/value.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <variant>
+
+using test::check;
+
+int main()
+{
+   lox::Heap heap;
+
+   check(lox::Value{}.is_nil() && !lox::Value{}.is_bool() && !lox::Value{}.is_number(), "default value is nil");
+   check(lox::Value{true}.is_bool() && lox::Value{true}.as_bool(), "true round trips");
+   check(lox::Value{false}.is_bool() && !lox::Value{false}.as_bool(), "false round trips");
+   check(lox::Value{false}.is_falsey() && lox::Value::nil().is_falsey() && !lox::Value{0.0}.is_falsey(), "truthiness");
+   check(lox::Value{-2.5}.is_number() && lox::Value{-2.5}.as_number() == -2.5, "negative number round trips");
+
+   auto nan = lox::Value{std::numeric_limits<double>::quiet_NaN()};
+   check(nan.is_number() && std::isnan(nan.as_number()) && !(nan == nan), "NaN stays a number and is not equal to itself");
+   auto infinity = lox::Value{-std::numeric_limits<double>::infinity()};
+   check(infinity.is_number() && !infinity.is_obj(), "infinity is a number");
+
+   auto text = lox::to_value(lox::LiteralType{std::string_view{"lox"}}, heap);
+   check(text.is_obj() && text.is_string() && !text.is_number(), "strings are objects");
+   check(text == lox::Value{heap.make_string("lox")}, "strings compare by content");
+   check(heap.intern("lox") == text.as_string() && heap.interned_count() == 1, "equal strings are interned once");
+   check(!(text == lox::Value{heap.intern("lax")}) && heap.interned_count() == 2, "distinct strings differ");
+   check(std::get<std::string_view>(lox::to_literal(text)) == "lox", "string converts back to a literal");
+   check(std::get<double>(lox::to_literal(lox::to_value(lox::LiteralType{4.0}, heap))) == 4.0, "number literal round trips");
+   check(std::holds_alternative<std::monostate>(lox::to_literal(lox::Value::nil())), "nil converts to monostate");
+   check(lox::stringify(lox::Value{3.0}) == "3" && lox::stringify(lox::Value{0.5}) == "0.5", "numbers print shortest form");
+
+   return test::finish("value");
+}
@@ -0,0 +1,106 @@
+#include "test_support.hpp"
+
+#include <lox/lox.hpp>
+#include <lox/vm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+   using test::compile;
+   using test::failures;
+
+   auto run(std::string_view code, std::ostream &out) -> lox::EvalResult
+   {
+      lox::VM vm{out};
+      return vm.run(compile(code));
+   }
+
+   void expect(std::string_view code, std::string_view result, std::string_view output = "")
+   {
+      std::ostringstream out;
+      auto value = lox::stringify(run(code, out));
+      if (value != result || out.str() != output)
+      {
+         std::cout << "FAIL: " << code << "\n  result: " << value << " (expected " << result << ")"
+                   << "\n  output: " << out.str() << " (expected " << output << ")" << std::endl;
+         failures++;
+      }
+   }
+
+   void expect_error(std::string_view code)
+   {
+      std::ostringstream out;
+      try
+      {
+         run(code, out);
+         std::cout << "FAIL: expected an error from " << code << std::endl;
+         failures++;
+      }
+      catch (LoxException &)
+      {
+      }
+   }
+}
+
+int main()
+{
+   expect("1 + 2 * 3;", "7");
+   expect("(1 + 2) * 3 - -1;", "10");
+   expect("!(1 < 2) == false;", "true");
+   expect("3 >= 3 and 2 <= 1;", "false");
+   expect("nil or \"fallback\";", "fallback");
+   expect("\"lo\" + \"x\";", "lox");
+   expect("\"lo\" + \"x\" == \"lox\";", "true");
+   expect("var s = \"a\"; s = s + \"b\"; s != \"ab\";", "false");
+   expect("print 1 / 4;", "nil", "0.25\n");
+   expect("1 - 2 - 3 - 4;", "-8");
+   expect("8 / 4 / 2;", "1");
+   expect("-2 * -3 + 1 < 8 == true;", "true");
+   expect("false and true or true;", "true");
+
+   expect("var a = 1; var b = a + 1; a = b * 10; a;", "20");
+   expect("var a; var b; a = b = 3; a + b;", "6");
+   expect("var a = \"global\"; { var a = \"local\"; print a; } a;", "global", "local\n");
+   expect("{ var a = 1; { var b = a + 1; a = b; } print a; }", "nil", "2\n");
+   expect("var i = 0; var sum = 0; while (i < 5) { sum = sum + i; i = i + 1; } sum;", "10");
+   expect("var sum = 0; for (var i = 1; i <= 100; i = i + 1) sum = sum + i; sum;", "5050");
+   expect("if (1 > 2) print \"then\"; else print \"else\";", "nil", "else\n");
+
+   // Sequences the compiler fuses into superinstructions behave like the instructions they replace
+   expect("{ var n = 2; print 1 + n; }", "nil", "3\n");
+   expect("{ var s = \"b\"; print \"a\" + s; }", "nil", "ab\n");
+   expect("var s = \"x\"; s + \"y\";", "xy");
+   expect("var i = 5; i < 10 == (i > 3);", "true");
+   expect("var i = 0; while (i < 3) { if (i == 1) print i; i = i + 1; } i;", "3", "1\n");
+   // A jump lands between the operand and the operator, they must not be fused
+   expect("var a = 1; a + (5 or 2);", "6");
+
+   expect_error("-\"text\";");
+   expect_error("1 + \"text\";");
+   expect_error("{ var s = \"a\"; 1 + s; }");
+   expect_error("var s = \"a\"; s < 1;");
+   expect_error("undefined_variable;");
+   expect_error("{ var a = a; }");
+   expect_error("var a; var b; a + b = 1;");
+   expect_error("1 @ 2;");
+   expect_error("print \"unterminated;");
+   expect_error("a = 1; var a;");
+   expect_error("{ var a = 1; var a = 2; }");
+
+   // Globals outlive a run, separately compiled chunks link their slots to the same variables
+   std::ostringstream out;
+   lox::VM vm{out};
+   vm.run(compile("var unused = 0; var a = 1;"));
+   auto linked = lox::stringify(vm.run(compile("var b = a + 1; { var a = 10; b = b + a; } b;")));
+   if (linked != "12")
+   {
+      std::cout << "FAIL: globals across runs gave " << linked << " (expected 12)" << std::endl;
+      failures++;
+   }
+
+   return test::finish("vm");
+}